@@ -1,9 +1,13 @@
 #version 430 core
 layout (location = 0) in vec3 vertex_position;
 layout (location = 1) in vec3 vertex_normal;
-uniform mat4 M;
+uniform vec4 T; // Model transform: x, y, rotation around z, uniform scale
 uniform mat4 V;
 uniform mat4 P;
 void main() {
-	gl_Position = P * V * M * vec4(vertex_position, 1.0);
+	vec3 p = vertex_position * T.w;
+	float c = cos(T.z);
+	float s = sin(T.z);
+	vec4 world_position = vec4(p.x * c - p.y * s + T.x, p.x * s + p.y * c + T.y, p.z, 1.0);
+	gl_Position = P * V * world_position;
 }
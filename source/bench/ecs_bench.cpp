@@ -0,0 +1,458 @@
+// ecs_bench.cpp
+#include "game/ecs.h"
+#include "game/archetype.h"
+#include "game/quadtree.h"
+#include "game/linear_quadtree.h"
+#include "math/transform.h"
+#include "math/morton.h"
+#include "system/radix_sort.h"
+#include "system/random.h"
+
+// Compares EntityComponentList against ArchetypeStore on the game's entity mix, nine asteroids
+// (physics + render + sound) to one projectile (physics + render). Also times a walk over randomly spawned
+// asteroids in spatial order, the access pattern of quadtree leaves, before and after sort_spatially(), and
+// a per frame quadtree rebuild against incremental updates that move a fraction of the entities, and the
+// pointer quadtree against the linear one on build and player sized queries.
+// Build with the ASTEROIDS_BUILD_BENCHMARKS CMake option, entity counts can be passed on the command line.
+
+using namespace Asteroids;
+
+constexpr int32_t BENCH_UPDATE_ITERATIONS = 10;
+constexpr float BENCH_DELTA_TIME = 16.0F;
+constexpr int32_t BENCH_QUADTREE_DEPTH = 10;
+constexpr int32_t BENCH_QUADTREE_MOVER_PERCENT = 1;
+constexpr int32_t BENCH_QUADTREE_QUERIES = 10000;
+static const size_t BENCH_ARENA_SIZE = System::GB(4);
+
+struct BenchTimes {
+  double create_ms;
+  double update_ms; // Per iteration
+  double destroy_ms;
+};
+
+static bool is_projectile(int32_t i) {
+  return i % 10 == 9;
+}
+
+static BenchTimes bench_entity_component_list(int32_t entity_count) {
+  BenchTimes times = {};
+  auto arena = System::memory_arena_create("ECLBENCH", BENCH_ARENA_SIZE);
+  auto view_arena = System::memory_arena_create("ECLVIEW", BENCH_ARENA_SIZE);
+
+  {
+    Game::EntityComponentList list;
+    if (!list.init(arena, entity_count)) {
+      System::log_error("EntityComponentList init failed for %d entities", entity_count);
+      System::memory_arena_free(view_arena);
+      System::memory_arena_free(arena);
+      return times;
+    }
+
+    System::StopWatch timer;
+    for (int32_t i = 0; i < entity_count; i++) {
+      const Game::ComponentSignature components = is_projectile(i)
+        ? Game::PHYSICS_COMPONENT | Game::RENDER_COMPONENT
+        : Game::PHYSICS_COMPONENT | Game::RENDER_COMPONENT | Game::SOUND_COMPONENT;
+
+      const Game::Entity* entity = list.create_entity(components);
+      Game::PhysicsComponentArrays* physics = &list.components<Game::PhysicsComponent>();
+      physics->vel_x[entity->index<Game::PhysicsComponent>()] = 1.0F;
+      physics->vel_y[entity->index<Game::PhysicsComponent>()] = float(i % 7);
+    }
+    times.create_ms = timer.elapsed_ms();
+
+    timer.reset();
+    for (int32_t iteration = 0; iteration < BENCH_UPDATE_ITERATIONS; iteration++) {
+      System::memory_arena_clear(view_arena);
+
+      auto physics = &list.components<Game::PhysicsComponent>();
+      for (int32_t i = 0; i < physics->used; i++) {
+        physics->pos_x[i] += physics->vel_x[i] * BENCH_DELTA_TIME;
+        physics->pos_y[i] += physics->vel_y[i] * BENCH_DELTA_TIME;
+      }
+
+      for (const auto& row : list.view<Game::PhysicsComponent, Game::RenderComponent>(view_arena)) {
+        Math::Transform2D* transform = &list.components<Game::RenderComponent>()[row.index<Game::RenderComponent>()].transform;
+        transform->x = physics->pos_x[row.index<Game::PhysicsComponent>()];
+        transform->y = physics->pos_y[row.index<Game::PhysicsComponent>()];
+      }
+    }
+    times.update_ms = timer.elapsed_ms() / BENCH_UPDATE_ITERATIONS;
+
+    timer.reset();
+    for (int32_t i = 0; i < entity_count; i += 3) {
+      list.destroy_entity(i);
+    }
+    list.compact();
+    times.destroy_ms = timer.elapsed_ms();
+  }
+
+  System::memory_arena_free(view_arena);
+  System::memory_arena_free(arena);
+  return times;
+}
+
+static BenchTimes bench_archetype_store(int32_t entity_count) {
+  BenchTimes times = {};
+  auto arena = System::memory_arena_create("ARCHBENCH", BENCH_ARENA_SIZE);
+
+  {
+    Game::ArchetypeStore store;
+    if (!store.init(arena, entity_count)) {
+      System::log_error("ArchetypeStore init failed for %d entities", entity_count);
+      System::memory_arena_free(arena);
+      return times;
+    }
+
+    System::StopWatch timer;
+    for (int32_t i = 0; i < entity_count; i++) {
+      const Game::EcsId entity_id = is_projectile(i)
+        ? store.create_entity<Game::PhysicsComponent, Game::RenderComponent>()
+        : store.create_entity<Game::PhysicsComponent, Game::RenderComponent, Game::SoundComponent>();
+
+      Game::PhysicsComponent* physics = store.get<Game::PhysicsComponent>(entity_id);
+      physics->velocity = Math::V3{1.0F, float(i % 7), 0.0F};
+    }
+    times.create_ms = timer.elapsed_ms();
+
+    timer.reset();
+    for (int32_t iteration = 0; iteration < BENCH_UPDATE_ITERATIONS; iteration++) {
+      store.for_each<Game::PhysicsComponent, Game::RenderComponent>(
+        [](int32_t count, const Game::EcsId*, Game::PhysicsComponent* physics, Game::RenderComponent* render) {
+          for (int32_t i = 0; i < count; i++) {
+            physics[i].aabb.pos = physics[i].aabb.pos + (physics[i].velocity * BENCH_DELTA_TIME);
+            render[i].transform.x = physics[i].aabb.pos.x;
+            render[i].transform.y = physics[i].aabb.pos.y;
+          }
+        });
+    }
+    times.update_ms = timer.elapsed_ms() / BENCH_UPDATE_ITERATIONS;
+
+    timer.reset();
+    for (int32_t i = 0; i < entity_count; i += 3) {
+      store.destroy_entity(i);
+    }
+    times.destroy_ms = timer.elapsed_ms();
+
+    store.finalize();
+  }
+
+  System::memory_arena_free(arena);
+  return times;
+}
+
+// Same entity mix as bench_entity_component_list but created through two prefab batches.
+static double bench_spawn_batch(int32_t entity_count) {
+  double spawn_ms = 0.0;
+  auto arena = System::memory_arena_create("SPAWNBENCH", BENCH_ARENA_SIZE);
+
+  {
+    Game::EntityComponentList list;
+    if (!list.init(arena, entity_count)) {
+      System::log_error("EntityComponentList init failed for %d entities", entity_count);
+      System::memory_arena_free(arena);
+      return spawn_ms;
+    }
+
+    Game::Prefab asteroid = {};
+    asteroid.components = Game::PHYSICS_COMPONENT | Game::RENDER_COMPONENT | Game::SOUND_COMPONENT;
+    asteroid.half_edge = 1.0F;
+    asteroid.velocity = Math::V3{1.0F, 0.0F, 0.0F};
+
+    Game::Prefab projectile = asteroid;
+    projectile.components = Game::PHYSICS_COMPONENT | Game::RENDER_COMPONENT;
+
+    const int32_t projectile_count = entity_count / 10;
+    auto place = [](Game::PhysicsComponentArrays* physics, int32_t begin, int32_t end) {
+      for (int32_t i = begin; i < end; i++) {
+        physics->vel_y[i] = float(i % 7);
+      }
+    };
+
+    System::StopWatch timer;
+    list.spawn_batch(&asteroid, entity_count - projectile_count, place);
+    list.spawn_batch(&projectile, projectile_count, place);
+    spawn_ms = timer.elapsed_ms();
+  }
+
+  System::memory_arena_free(arena);
+  return spawn_ms;
+}
+
+struct SpatialWalkTimes {
+  double unsorted_ms;
+  double sorted_ms;
+  double sort_ms;
+  double unsorted_line_jumps; // Share of steps landing more than a cache line from the previous one
+  double sorted_line_jumps;
+};
+
+// Visits entities in Morton order through their component indices and sums what it reads.
+static double walk_spatially(const Game::EntityComponentList* list, const Game::EcsId* order, int32_t count,
+  double* line_jumps, float* sink) {
+  constexpr int32_t FLOATS_PER_LINE = int32_t(System::CACHE_LINE_SIZE / sizeof(float));
+  const auto physics = &list->components<Game::PhysicsComponent>();
+  const auto render = &list->components<Game::RenderComponent>();
+
+  int32_t jumps = 0;
+  int32_t previous_idx = 0;
+  float sum = 0.0F;
+
+  System::StopWatch timer;
+  for (int32_t i = 0; i < count; i++) {
+    const Game::Entity* entity = &list->entities[order[i]];
+    const int32_t physics_idx = entity->index<Game::PhysicsComponent>();
+
+    sum += physics->pos_x[physics_idx] + physics->pos_y[physics_idx] + physics->half_edge[physics_idx];
+    sum += (*render)[entity->index<Game::RenderComponent>()].transform.x;
+
+    jumps += abs(physics_idx - previous_idx) > FLOATS_PER_LINE ? 1 : 0;
+    previous_idx = physics_idx;
+  }
+  const double elapsed_ms = timer.elapsed_ms();
+
+  *line_jumps = count > 0 ? double(jumps) / count : 0.0;
+  *sink += sum;
+  return elapsed_ms;
+}
+
+static SpatialWalkTimes bench_spatial_sort(int32_t entity_count, float* sink) {
+  SpatialWalkTimes times = {};
+  auto arena = System::memory_arena_create("SORTBENCH", BENCH_ARENA_SIZE);
+  auto scratch_arena = System::memory_arena_create("SORTSCRT", BENCH_ARENA_SIZE);
+
+  {
+    Game::EntityComponentList list;
+    if (!list.init(arena, entity_count)) {
+      System::log_error("EntityComponentList init failed for %d entities", entity_count);
+      System::memory_arena_free(scratch_arena);
+      System::memory_arena_free(arena);
+      return times;
+    }
+
+    System::Random random;
+    const float half_edge = 100000.0F;
+
+    for (int32_t i = 0; i < entity_count; i++) {
+      const Game::Entity* entity = list.create_entity(Game::PHYSICS_COMPONENT | Game::RENDER_COMPONENT | Game::SOUND_COMPONENT);
+      Game::PhysicsComponentArrays* physics = &list.components<Game::PhysicsComponent>();
+      physics->pos_x[entity->index<Game::PhysicsComponent>()] = random.random_float(-1, 1) * half_edge;
+      physics->pos_y[entity->index<Game::PhysicsComponent>()] = random.random_float(-1, 1) * half_edge;
+    }
+
+    // Entity ids in the order a leaf walk of a spatial index visits them, it does not change with the sort.
+    uint32_t* keys = System::arena_push<uint32_t>(arena, entity_count);
+    int32_t* sorted = System::arena_push<int32_t>(arena, entity_count);
+    Game::EcsId* order = System::arena_push<Game::EcsId>(arena, entity_count);
+
+    const Game::PhysicsComponentArrays& physics = list.components<Game::PhysicsComponent>();
+    for (int32_t i = 0; i < entity_count; i++) {
+      keys[i] = Math::morton_code(physics.pos_x[i], physics.pos_y[i], half_edge);
+    }
+
+    System::radix_sort_indices(keys, entity_count, sorted, scratch_arena);
+    for (int32_t i = 0; i < entity_count; i++) {
+      order[i] = physics.entity_id[sorted[i]];
+    }
+
+    times.unsorted_ms = walk_spatially(&list, order, entity_count, &times.unsorted_line_jumps, sink);
+
+    System::StopWatch timer;
+    list.sort_spatially(scratch_arena);
+    times.sort_ms = timer.elapsed_ms();
+
+    times.sorted_ms = walk_spatially(&list, order, entity_count, &times.sorted_line_jumps, sink);
+  }
+
+  System::memory_arena_free(scratch_arena);
+  System::memory_arena_free(arena);
+  return times;
+}
+
+struct QuadTreeTimes {
+  double rebuild_ms;
+  double incremental_ms; // Moving BENCH_QUADTREE_MOVER_PERCENT of the entities
+  int32_t movers;
+};
+
+static QuadTreeTimes bench_quadtree(int32_t entity_count) {
+  QuadTreeTimes times = {};
+  auto arena = System::memory_arena_create("QTBENCH", BENCH_ARENA_SIZE);
+  auto frame_arena = System::memory_arena_create("QTFRAME", BENCH_ARENA_SIZE);
+
+  const float half_edge = 100000.0F;
+  Math::AABB* boxes = System::arena_push<Math::AABB>(arena, entity_count);
+  System::Random random;
+  for (int32_t i = 0; i < entity_count; i++) {
+    boxes[i].pos = Math::V3{random.random_float(-0.9F, 0.9F) * half_edge, random.random_float(-0.9F, 0.9F) * half_edge, 0.0F};
+    boxes[i].half_edge = random.random_float(5.0F, 50.0F);
+  }
+
+  {
+    System::StopWatch timer;
+    for (int32_t iteration = 0; iteration < BENCH_UPDATE_ITERATIONS; iteration++) {
+      System::memory_arena_reset(frame_arena);
+
+      Game::QuadTree tree;
+      tree.init(frame_arena, BENCH_QUADTREE_DEPTH, half_edge);
+      for (int32_t i = 0; i < entity_count; i++) {
+        tree.insert(Game::EntityHandle{i, 0}, boxes[i]);
+      }
+    }
+    times.rebuild_ms = timer.elapsed_ms() / BENCH_UPDATE_ITERATIONS;
+  }
+
+  Game::QuadTree tree;
+  if (!tree.init_incremental(arena, BENCH_QUADTREE_DEPTH, half_edge, entity_count)) {
+    System::log_error("QuadTree init failed for %d entities", entity_count);
+  } else {
+    for (int32_t i = 0; i < entity_count; i++) {
+      tree.update(Game::EntityHandle{i, 0}, boxes[i]);
+    }
+
+    const int32_t stride = 100 / BENCH_QUADTREE_MOVER_PERCENT;
+    times.movers = (entity_count + stride - 1) / stride;
+
+    System::StopWatch timer;
+    for (int32_t iteration = 0; iteration < BENCH_UPDATE_ITERATIONS; iteration++) {
+      for (int32_t i = iteration % stride; i < entity_count; i += stride) {
+        boxes[i].pos.x += random.random_float(-1.0F, 1.0F) * 2000.0F;
+        boxes[i].pos.y += random.random_float(-1.0F, 1.0F) * 2000.0F;
+        tree.update(Game::EntityHandle{i, 0}, boxes[i]);
+      }
+
+      tree.merge_empty_nodes();
+    }
+    times.incremental_ms = timer.elapsed_ms() / BENCH_UPDATE_ITERATIONS;
+  }
+
+  System::memory_arena_free(frame_arena);
+  System::memory_arena_free(arena);
+  return times;
+}
+
+struct LinearQuadTreeTimes {
+  double pointer_build_ms;
+  double linear_build_ms;
+  double pointer_query_ms; // All BENCH_QUADTREE_QUERIES
+  double linear_query_ms;
+  double pointer_candidates; // Per query
+  double linear_candidates;
+};
+
+static LinearQuadTreeTimes bench_linear_quadtree(int32_t entity_count) {
+  LinearQuadTreeTimes times = {};
+  auto arena = System::memory_arena_create("LQTBENCH", BENCH_ARENA_SIZE);
+  auto scratch_arena = System::memory_arena_create("LQTSCRT", BENCH_ARENA_SIZE);
+
+  Game::PhysicsComponentArrays physics = {};
+  Game::LinearQuadTree linear_tree;
+  Math::AABB* queries = System::arena_push<Math::AABB>(arena, BENCH_QUADTREE_QUERIES);
+  if (!queries || !physics.init(arena, entity_count)
+    || !linear_tree.init(arena, BENCH_QUADTREE_DEPTH, 100000.0F, entity_count)) {
+    System::log_error("LinearQuadTree init failed for %d entities", entity_count);
+    System::memory_arena_free(scratch_arena);
+    System::memory_arena_free(arena);
+    return times;
+  }
+
+  const float half_edge = 100000.0F;
+  System::Random random;
+  for (int32_t i = 0; i < entity_count; i++) {
+    physics.pos_x[i] = random.random_float(-0.9F, 0.9F) * half_edge;
+    physics.pos_y[i] = random.random_float(-0.9F, 0.9F) * half_edge;
+    physics.half_edge[i] = random.random_float(5.0F, 50.0F);
+    physics.entity_id[i] = i;
+  }
+  physics.used = entity_count;
+
+  for (int32_t i = 0; i < BENCH_QUADTREE_QUERIES; i++) {
+    queries[i].pos = Math::V3{random.random_float(-0.9F, 0.9F) * half_edge, random.random_float(-0.9F, 0.9F) * half_edge, 0.0F};
+    queries[i].half_edge = 15.0F;
+  }
+
+  // The pointer tree is built the way the loop rebuilds it every frame.
+  Game::QuadTree tree;
+  {
+    System::StopWatch timer;
+    tree.init(arena, BENCH_QUADTREE_DEPTH, half_edge);
+    for (int32_t i = 0; i < entity_count; i++) {
+      tree.insert(Game::EntityHandle{i, 0}, physics.aabb(i));
+    }
+    times.pointer_build_ms = timer.elapsed_ms();
+  }
+
+  {
+    System::StopWatch timer;
+    linear_tree.build(physics, scratch_arena);
+    times.linear_build_ms = timer.elapsed_ms();
+  }
+
+  int64_t candidates = 0;
+  {
+    System::StopWatch timer;
+    for (int32_t i = 0; i < BENCH_QUADTREE_QUERIES; i++) {
+      tree.query_candidates(queries[i], [&candidates](Game::EntityHandle entity) {
+        candidates += entity.index >= 0 ? 1 : 0;
+      });
+    }
+    times.pointer_query_ms = timer.elapsed_ms();
+  }
+  times.pointer_candidates = double(candidates) / BENCH_QUADTREE_QUERIES;
+
+  candidates = 0;
+  {
+    System::StopWatch timer;
+    for (int32_t i = 0; i < BENCH_QUADTREE_QUERIES; i++) {
+      linear_tree.query(queries[i], [&candidates](Game::EcsId entity_id) {
+        candidates += entity_id >= 0 ? 1 : 0;
+      });
+    }
+    times.linear_query_ms = timer.elapsed_ms();
+  }
+  times.linear_candidates = double(candidates) / BENCH_QUADTREE_QUERIES;
+
+  System::memory_arena_free(scratch_arena);
+  System::memory_arena_free(arena);
+  return times;
+}
+
+int main(int argc, char* argv[]) {
+  int32_t entity_counts[8] = {10000, 100000, 1000000};
+  int32_t entity_count_count = 3;
+
+  if (argc > 1) {
+    entity_count_count = 0;
+    for (int i = 1; i < argc && entity_count_count < 8; i++) {
+      entity_counts[entity_count_count++] = System::max(atoi(argv[i]), 1);
+    }
+  }
+
+  for (int32_t i = 0; i < entity_count_count; i++) {
+    const int32_t entity_count = entity_counts[i];
+    const BenchTimes list = bench_entity_component_list(entity_count);
+    const BenchTimes archetype = bench_archetype_store(entity_count);
+
+    System::log_info("%7d entities   create ms   update ms   destroy ms", entity_count);
+    System::log_info("  EntityComponentList %9.3lf %11.3lf %12.3lf", list.create_ms, list.update_ms, list.destroy_ms);
+    System::log_info("  ArchetypeStore      %9.3lf %11.3lf %12.3lf", archetype.create_ms, archetype.update_ms, archetype.destroy_ms);
+    System::log_info("  Prefab spawn_batch  %9.3lf", bench_spawn_batch(entity_count));
+
+    float sink = 0.0F;
+    const SpatialWalkTimes walk = bench_spatial_sort(entity_count, &sink);
+    System::log_info("  Spatial walk unsorted %.3lf ms (%.1lf%% line jumps), sorted %.3lf ms (%.1lf%% line jumps), sort %.3lf ms [%g]",
+      walk.unsorted_ms, walk.unsorted_line_jumps * 100.0, walk.sorted_ms, walk.sorted_line_jumps * 100.0, walk.sort_ms, sink);
+
+    const QuadTreeTimes quadtree = bench_quadtree(entity_count);
+    System::log_info("  QuadTree rebuild %.3lf ms, incremental %.3lf ms (%d movers)",
+      quadtree.rebuild_ms, quadtree.incremental_ms, quadtree.movers);
+
+    const LinearQuadTreeTimes linear = bench_linear_quadtree(entity_count);
+    System::log_info("  QuadTree build %.3lf ms, %d queries %.3lf ms (%.1lf candidates)",
+      linear.pointer_build_ms, BENCH_QUADTREE_QUERIES, linear.pointer_query_ms, linear.pointer_candidates);
+    System::log_info("  LinearQuadTree build %.3lf ms, %d queries %.3lf ms (%.1lf candidates)",
+      linear.linear_build_ms, BENCH_QUADTREE_QUERIES, linear.linear_query_ms, linear.linear_candidates);
+  }
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+// archetype.cpp
+#include "archetype.h"
+
+#include <array>
+
+namespace Asteroids {
+namespace Game {
+
+// Indexed by ComponentTraits<T>::TYPE_INDEX. Chunks store PhysicsComponent by value, not as arrays.
+template <typename... Ts> static constexpr auto component_sizes(ComponentTypeList<Ts...>) {
+  return std::array<size_t, sizeof...(Ts)>{sizeof(Ts)...};
+}
+
+static constexpr auto COMPONENT_SIZES = component_sizes(ComponentRegistry{});
+
+static size_t chunk_bytes(ArchetypeSignature signature, int32_t capacity) {
+  size_t bytes = System::align_up(capacity * sizeof(EcsId), System::CACHE_LINE_SIZE);
+
+  for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+    if (signature.test(t)) {
+      bytes += System::align_up(capacity * COMPONENT_SIZES[t], System::CACHE_LINE_SIZE);
+    }
+  }
+
+  return bytes;
+}
+
+static void init_chunk_layout(Archetype* archetype) {
+  size_t row_size = sizeof(EcsId);
+  for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+    if (archetype->signature.test(t)) {
+      row_size += COMPONENT_SIZES[t];
+    }
+  }
+
+  // Start from the unpadded estimate and back off until the aligned columns fit.
+  int32_t capacity = int32_t(ARCHETYPE_CHUNK_SIZE / row_size);
+  while (capacity > 1 && chunk_bytes(archetype->signature, capacity) > ARCHETYPE_CHUNK_SIZE) {
+    capacity--;
+  }
+
+  archetype->chunk_capacity = capacity;
+
+  size_t offset = System::align_up(capacity * sizeof(EcsId), System::CACHE_LINE_SIZE);
+  for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+    if (archetype->signature.test(t)) {
+      archetype->column_offsets[t] = offset;
+      offset += System::align_up(capacity * COMPONENT_SIZES[t], System::CACHE_LINE_SIZE);
+    } else {
+      archetype->column_offsets[t] = MAX_SIZE_T;
+    }
+  }
+}
+
+bool ArchetypeStore::init(System::MemoryArena* arena, int32_t max_entity_count) {
+  ASSERT(arena && max_entity_count > 0);
+
+  arena_ = arena;
+  max_entities_ = max_entity_count;
+
+  locations_ = System::arena_push<ArchetypeLocation>(arena_, max_entities_);
+  if (!locations_) {
+    return false;
+  }
+
+  return free_entities_.init(arena_, max_entities_);
+}
+
+void ArchetypeStore::finalize() {
+  for (int32_t a = 0; a < archetype_count_; a++) {
+    const Archetype* archetype = &archetypes_[a];
+    System::log_info("ARCHETYPE 0x%llx: %d entities, %d per chunk, %d chunks",
+      (unsigned long long)archetype->signature.words[0], archetype->entity_count, archetype->chunk_capacity, archetype->chunk_count);
+  }
+}
+
+Archetype* ArchetypeStore::find_or_create_archetype(ArchetypeSignature signature) {
+  for (int32_t a = 0; a < archetype_count_; a++) {
+    if (archetypes_[a].signature == signature) {
+      return &archetypes_[a];
+    }
+  }
+
+  ASSERT(archetype_count_ < MAX_ARCHETYPES);
+  if (archetype_count_ == MAX_ARCHETYPES) {
+    return nullptr;
+  }
+
+  Archetype* archetype = &archetypes_[archetype_count_];
+  archetype->signature = signature;
+  init_chunk_layout(archetype);
+
+  archetype->max_chunk_count = max_entities_ / archetype->chunk_capacity + 1;
+  archetype->chunks = System::arena_push<uint8_t*>(arena_, archetype->max_chunk_count);
+  if (!archetype->chunks) {
+    return nullptr;
+  }
+
+  archetype->chunk_count = 0;
+  archetype->entity_count = 0;
+
+  archetype_count_++;
+  return archetype;
+}
+
+EcsId ArchetypeStore::create_entity(ArchetypeSignature signature) {
+  Archetype* archetype = find_or_create_archetype(signature);
+  if (!archetype) {
+    return ECSID_NOT_INITIALIZED;
+  }
+
+  EcsId entity_id = ECSID_NOT_INITIALIZED;
+  if (!free_entities_.empty()) {
+    entity_id = free_entities_[free_entities_.size() - 1];
+    free_entities_.pop();
+  } else if (entities_used_ < max_entities_) {
+    entity_id = entities_used_++;
+  } else {
+    ASSERT(false);
+    return ECSID_NOT_INITIALIZED;
+  }
+
+  const int32_t row = archetype->entity_count;
+  const int32_t chunk_idx = row / archetype->chunk_capacity;
+  const int32_t chunk_row = row % archetype->chunk_capacity;
+
+  if (chunk_idx == archetype->chunk_count) {
+    ASSERT(chunk_idx < archetype->max_chunk_count);
+    archetype->chunks[chunk_idx] = System::arena_push<uint8_t>(arena_, ARCHETYPE_CHUNK_SIZE, System::CACHE_LINE_SIZE);
+    if (!archetype->chunks[chunk_idx]) {
+      return ECSID_NOT_INITIALIZED;
+    }
+
+    archetype->chunk_count++;
+  }
+
+  uint8_t* chunk = archetype->chunks[chunk_idx];
+  ((EcsId*)chunk)[chunk_row] = entity_id;
+
+  for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+    if (archetype->column_offsets[t] != MAX_SIZE_T) {
+      memset(chunk + archetype->column_offsets[t] + chunk_row * COMPONENT_SIZES[t], 0, COMPONENT_SIZES[t]);
+    }
+  }
+
+  archetype->entity_count++;
+  locations_[entity_id] = ArchetypeLocation{int32_t(archetype - archetypes_), row};
+  live_count_++;
+
+  return entity_id;
+}
+
+void ArchetypeStore::destroy_entity(EcsId entity_id) {
+  ASSERT(entity_id >= 0 && entity_id < entities_used_);
+  ArchetypeLocation* location = &locations_[entity_id];
+  ASSERT(location->archetype_idx >= 0);
+
+  Archetype* archetype = &archetypes_[location->archetype_idx];
+  const int32_t row = location->row;
+  const int32_t last = --archetype->entity_count;
+
+  if (row != last) {
+    uint8_t* to_chunk = archetype->chunks[row / archetype->chunk_capacity];
+    uint8_t* from_chunk = archetype->chunks[last / archetype->chunk_capacity];
+    const int32_t to_row = row % archetype->chunk_capacity;
+    const int32_t from_row = last % archetype->chunk_capacity;
+
+    const EcsId moved_entity_id = ((EcsId*)from_chunk)[from_row];
+    ((EcsId*)to_chunk)[to_row] = moved_entity_id;
+
+    for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+      const size_t offset = archetype->column_offsets[t];
+      if (offset != MAX_SIZE_T) {
+        memcpy(to_chunk + offset + to_row * COMPONENT_SIZES[t], from_chunk + offset + from_row * COMPONENT_SIZES[t], COMPONENT_SIZES[t]);
+      }
+    }
+
+    locations_[moved_entity_id].row = row;
+  }
+
+  location->archetype_idx = ECSID_NOT_INITIALIZED;
+  free_entities_.push(entity_id);
+  live_count_--;
+}
+
+} //namespace
+} //namespace
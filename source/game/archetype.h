@@ -0,0 +1,107 @@
+// archetype.h
+#pragma once
+
+#include "ecs.h"
+
+namespace Asteroids {
+namespace Game {
+
+constexpr size_t ARCHETYPE_CHUNK_SIZE = System::KB(16);
+constexpr int32_t MAX_ARCHETYPES = 16;
+
+// One bit per component type, indexed by ComponentTraits<T>::TYPE_INDEX.
+using ArchetypeSignature = ComponentSignature;
+
+template <typename... Ts> constexpr ArchetypeSignature archetype_signature() {
+  return component_signature<Ts...>();
+}
+
+// Entities with the same signature share 16 KB chunks. A chunk holds the entity ids followed by one
+// column per component, each column cache line aligned, so a loop over one archetype reads sequential memory.
+struct Archetype {
+  ArchetypeSignature signature;
+  int32_t chunk_capacity; // Entities per chunk
+  size_t column_offsets[COMPONENT_TYPE_COUNT]; // MAX_SIZE_T when the archetype lacks the component
+  uint8_t** chunks;
+  int32_t chunk_count; // Chunks ever allocated, trailing empty chunks are kept for reuse
+  int32_t max_chunk_count;
+  int32_t entity_count;
+};
+
+struct ArchetypeLocation {
+  int32_t archetype_idx;
+  int32_t row;
+};
+
+class ArchetypeStore final {
+  DISABLE_COPY_AND_MOVE(ArchetypeStore);
+public:
+  ArchetypeStore() = default;
+  ~ArchetypeStore() = default;
+
+  bool init(System::MemoryArena* arena, int32_t max_entity_count);
+  void finalize();
+
+  template <typename... Ts> EcsId create_entity() {
+    return create_entity(archetype_signature<Ts...>());
+  }
+
+  // Components start zeroed. Destruction moves the archetype's last entity into the freed row.
+  EcsId create_entity(ArchetypeSignature signature);
+  void destroy_entity(EcsId entity_id);
+
+  template <typename T> T* get(EcsId entity_id) const {
+    ASSERT(entity_id >= 0 && entity_id < entities_used_);
+    const ArchetypeLocation location = locations_[entity_id];
+    ASSERT(location.archetype_idx >= 0);
+
+    const Archetype* archetype = &archetypes_[location.archetype_idx];
+    const size_t offset = archetype->column_offsets[ComponentTraits<T>::TYPE_INDEX];
+    if (offset == MAX_SIZE_T) {
+      return nullptr;
+    }
+
+    uint8_t* chunk = archetype->chunks[location.row / archetype->chunk_capacity];
+    return (T*)(chunk + offset) + location.row % archetype->chunk_capacity;
+  }
+
+  // Calls f(count, entity_ids, Ts* columns...) once per non empty chunk of every archetype that has all of Ts.
+  template <typename... Ts, typename F> void for_each(F&& f) const {
+    constexpr ArchetypeSignature required = archetype_signature<Ts...>();
+
+    for (int32_t a = 0; a < archetype_count_; a++) {
+      const Archetype* archetype = &archetypes_[a];
+      if (!archetype->signature.contains(required)) {
+        continue;
+      }
+
+      int32_t remaining = archetype->entity_count;
+      for (int32_t c = 0; remaining > 0; c++) {
+        uint8_t* chunk = archetype->chunks[c];
+        const int32_t count = System::min(remaining, archetype->chunk_capacity);
+        f(count, (const EcsId*)chunk, (Ts*)(chunk + archetype->column_offsets[ComponentTraits<Ts>::TYPE_INDEX])...);
+        remaining -= count;
+      }
+    }
+  }
+
+  int32_t archetype_count() const { return archetype_count_; }
+  int32_t live_count() const { return live_count_; }
+
+private:
+  Archetype* find_or_create_archetype(ArchetypeSignature signature);
+
+  System::MemoryArena* arena_ = nullptr;
+  int32_t max_entities_ = 0;
+
+  Archetype archetypes_[MAX_ARCHETYPES] = {};
+  int32_t archetype_count_ = 0;
+
+  ArchetypeLocation* locations_ = nullptr;
+  int32_t entities_used_ = 0;
+  int32_t live_count_ = 0;
+  System::ArenaArray<EcsId> free_entities_;
+};
+
+} //namespace
+} //namespace
@@ -0,0 +1,182 @@
+// command_buffer.cpp
+#include "command_buffer.h"
+
+namespace Asteroids {
+namespace Game {
+
+static SDL_atomic_t command_thread_count = {};
+static thread_local int32_t command_thread_idx = -1;
+
+// Threads keep the same buffer for the lifetime of the process, indices are never handed back. A thread
+// past the first MAX_ENTITY_COMMAND_THREADS gets -1 and cannot record.
+static int32_t command_thread() {
+  if (command_thread_idx < 0) {
+    command_thread_idx = SDL_AtomicAdd(&command_thread_count, 1);
+  }
+
+  return command_thread_idx < MAX_ENTITY_COMMAND_THREADS ? command_thread_idx : -1;
+}
+
+bool EntityCommandBuffer::init(System::MemoryArena* arena, int32_t commands_per_thread) {
+  ASSERT(arena && commands_per_thread > 0);
+
+  for (ThreadBuffer& buffer : buffers_) {
+    if (!buffer.commands.init(arena, commands_per_thread) || !buffer.created.init(arena, commands_per_thread)) {
+      return false;
+    }
+
+    buffer.create_count = 0;
+  }
+
+  return true;
+}
+
+void EntityCommandBuffer::finalize() {
+  System::log_info("COMMANDS: %zu played back, %d dropped", played_back_count_, SDL_AtomicGet(&dropped_count_));
+}
+
+int32_t EntityCommandBuffer::pending_count() const {
+  int32_t count = 0;
+  for (const ThreadBuffer& buffer : buffers_) {
+    count += buffer.commands.size();
+  }
+
+  return count;
+}
+
+EntityCommand* EntityCommandBuffer::record(EntityCommandType type, EntityHandle entity) {
+  const int32_t thread = command_thread();
+  if (thread < 0) {
+    SDL_AtomicAdd(&dropped_count_, 1);
+    System::log_error("No entity command buffer left for this thread, command %d dropped", type);
+    return nullptr;
+  }
+
+  ThreadBuffer* buffer = &buffers_[thread];
+
+  EntityCommand* command = buffer->commands.full() ? nullptr : buffer->commands.push();
+  if (!command) {
+    SDL_AtomicAdd(&dropped_count_, 1);
+    System::log_error("Entity command buffer full, command %d dropped", type);
+    return nullptr;
+  }
+
+  command->type = type;
+  command->entity = entity;
+  return command;
+}
+
+EntityHandle EntityCommandBuffer::create_entity(ComponentSignature components) {
+  const int32_t thread = command_thread();
+  if (thread < 0) {
+    record(ENTITY_COMMAND_CREATE, ENTITY_HANDLE_NONE);
+    return ENTITY_HANDLE_NONE;
+  }
+
+  // Deferred handles count down from below ECSID_NOT_INITIALIZED and keep the recording thread's index in
+  // generation, resolve() reads the buffer back from there.
+  const EntityHandle deferred = {ECSID_NOT_INITIALIZED - 1 - buffers_[thread].create_count, uint32_t(thread)};
+
+  EntityCommand* command = record(ENTITY_COMMAND_CREATE, deferred);
+  if (!command) {
+    return ENTITY_HANDLE_NONE;
+  }
+
+  command->components = components;
+  buffers_[thread].create_count++;
+  return deferred;
+}
+
+void EntityCommandBuffer::destroy_entity(EntityHandle entity) {
+  record(ENTITY_COMMAND_DESTROY, entity);
+}
+
+void EntityCommandBuffer::set_physics(EntityHandle entity, const PhysicsComponent& physics) {
+  EntityCommand* command = record(ENTITY_COMMAND_SET_PHYSICS, entity);
+  if (command) {
+    command->physics = physics;
+  }
+}
+
+void EntityCommandBuffer::set_render(EntityHandle entity, int32_t vertex_array_idx) {
+  EntityCommand* command = record(ENTITY_COMMAND_SET_RENDER, entity);
+  if (command) {
+    command->vertex_array_idx = vertex_array_idx;
+  }
+}
+
+void EntityCommandBuffer::add_lifetime(EntityHandle entity, int64_t lifetime_ms) {
+  EntityCommand* command = record(ENTITY_COMMAND_ADD_LIFETIME, entity);
+  if (command) {
+    command->lifetime_ms = lifetime_ms;
+  }
+}
+
+// ECSID_NOT_INITIALIZED when the entity is gone or was never created.
+EcsId EntityCommandBuffer::resolve(const EntityComponentList* entity_list, EntityHandle entity) const {
+  if (is_deferred(entity)) {
+    ASSERT(entity.generation < uint32_t(MAX_ENTITY_COMMAND_THREADS));
+    const ThreadBuffer* buffer = &buffers_[entity.generation];
+    const int32_t created_idx = ECSID_NOT_INITIALIZED - 1 - entity.index;
+
+    ASSERT(created_idx < buffer->created.size());
+    return created_idx < buffer->created.size() ? buffer->created[created_idx] : ECSID_NOT_INITIALIZED;
+  }
+
+  return entity_list->is_valid(entity) ? entity.index : ECSID_NOT_INITIALIZED;
+}
+
+void EntityCommandBuffer::playback(EntityComponentList* entity_list, LifetimeSystem* lifetime_system) {
+  ASSERT(entity_list && lifetime_system);
+
+  for (ThreadBuffer& buffer : buffers_) {
+    for (const EntityCommand& command : buffer.commands) {
+      if (command.type == ENTITY_COMMAND_CREATE) {
+        const Entity* entity = entity_list->create_entity(command.components);
+        buffer.created.push(entity ? entity->entity_id : ECSID_NOT_INITIALIZED);
+        continue;
+      }
+
+      const EcsId entity_id = resolve(entity_list, command.entity);
+      if (entity_id == ECSID_NOT_INITIALIZED) {
+        continue;
+      }
+
+      const Entity* entity = &entity_list->entities[entity_id];
+
+      switch (command.type) {
+      case ENTITY_COMMAND_DESTROY:
+        entity_list->destroy_entity(entity_id);
+        break;
+      case ENTITY_COMMAND_SET_PHYSICS:
+        if (entity->has<PhysicsComponent>()) {
+          PhysicsComponent physics = command.physics;
+          physics.entity_id = entity_id;
+          entity_list->components<PhysicsComponent>().set(entity->index<PhysicsComponent>(), physics);
+          entity_list->mark_changed<PhysicsComponent>(entity_id);
+        }
+        break;
+      case ENTITY_COMMAND_SET_RENDER:
+        if (entity->has<RenderComponent>()) {
+          entity_list->components<RenderComponent>()[entity->index<RenderComponent>()].vertex_array_idx = command.vertex_array_idx;
+          entity_list->mark_changed<RenderComponent>(entity_id);
+        }
+        break;
+      case ENTITY_COMMAND_ADD_LIFETIME:
+        lifetime_system->add(entity_list, entity_id, command.lifetime_ms);
+        break;
+      default:
+        ASSERT(false);
+        break;
+      }
+    }
+
+    played_back_count_ += buffer.commands.size();
+    buffer.commands.clear();
+    buffer.created.clear();
+    buffer.create_count = 0;
+  }
+}
+
+} //namespace
+} //namespace
@@ -0,0 +1,77 @@
+// command_buffer.h
+#pragma once
+
+#include "ecs.h"
+#include "lifetime.h"
+
+namespace Asteroids {
+namespace Game {
+
+constexpr int32_t MAX_ENTITY_COMMAND_THREADS = 8;
+
+enum EntityCommandType : int32_t {
+  ENTITY_COMMAND_CREATE,
+  ENTITY_COMMAND_DESTROY,
+  ENTITY_COMMAND_SET_PHYSICS,
+  ENTITY_COMMAND_SET_RENDER,
+  ENTITY_COMMAND_ADD_LIFETIME,
+};
+
+struct EntityCommand {
+  EntityCommandType type;
+  EntityHandle entity;
+  union {
+    ComponentSignature components;
+    PhysicsComponent physics;
+    int32_t vertex_array_idx;
+    int64_t lifetime_ms;
+  };
+};
+
+// Records structural changes while systems iterate and applies them in one batch at a sync point, so
+// the component arrays never change under a running loop. Every recording thread gets its own buffer,
+// recording takes no locks. create_entity() hands out a deferred handle that later commands of the same
+// thread can target, playback() maps it to the real entity.
+class EntityCommandBuffer final {
+  DISABLE_COPY_AND_MOVE(EntityCommandBuffer);
+public:
+  EntityCommandBuffer() = default;
+  ~EntityCommandBuffer() = default;
+
+  bool init(System::MemoryArena* arena, int32_t commands_per_thread);
+  void finalize();
+
+  EntityHandle create_entity(ComponentSignature components);
+  void destroy_entity(EntityHandle entity);
+  void set_physics(EntityHandle entity, const PhysicsComponent& physics);
+  void set_render(EntityHandle entity, int32_t vertex_array_idx);
+  void add_lifetime(EntityHandle entity, int64_t lifetime_ms);
+
+  // Single threaded, no thread may record while this runs. Buffers are played back in thread order.
+  void playback(EntityComponentList* entity_list, LifetimeSystem* lifetime_system);
+
+  // Commands recorded since the last playback, over all threads.
+  int32_t pending_count() const;
+
+  // Deferred handles have an index below ECSID_NOT_INITIALIZED and the recording thread in generation.
+  static bool is_deferred(EntityHandle entity) {
+    return entity.index < ECSID_NOT_INITIALIZED;
+  }
+
+private:
+  struct ThreadBuffer {
+    System::ArenaArray<EntityCommand> commands;
+    System::ArenaArray<EcsId> created; // Deferred index to entity id, filled during playback
+    int32_t create_count;
+  };
+
+  EntityCommand* record(EntityCommandType type, EntityHandle entity);
+  EcsId resolve(const EntityComponentList* entity_list, EntityHandle entity) const;
+
+  ThreadBuffer buffers_[MAX_ENTITY_COMMAND_THREADS];
+  size_t played_back_count_ = 0;
+  SDL_atomic_t dropped_count_ = {};
+};
+
+} //namespace
+} //namespace
@@ -0,0 +1,181 @@
+// component_registry.h
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+
+#include "system/system.h"
+#include "system/memory.h"
+
+namespace Asteroids {
+namespace Game {
+
+using EcsId = int32_t;
+constexpr EcsId ECSID_NOT_INITIALIZED = -1;
+
+constexpr int32_t COMPONENT_SIGNATURE_WORDS = 2;
+constexpr int32_t MAX_COMPONENT_TYPES = COMPONENT_SIGNATURE_WORDS * 64;
+
+// One bit per registered component type, indexed by ComponentTraits<T>::TYPE_INDEX. Plain data, so it can
+// sit in unions, snapshots and command buffers. Every operation touches all words, none of them branch.
+struct ComponentSignature {
+  uint64_t words[COMPONENT_SIGNATURE_WORDS];
+
+  static constexpr ComponentSignature none() {
+    return ComponentSignature{};
+  }
+
+  static constexpr ComponentSignature of(int32_t type_index) {
+    ComponentSignature signature = {};
+    signature.words[type_index >> 6] = uint64_t(1) << (type_index & 63);
+    return signature;
+  }
+
+  constexpr void set(int32_t type_index) {
+    words[type_index >> 6] |= uint64_t(1) << (type_index & 63);
+  }
+
+  constexpr bool test(int32_t type_index) const {
+    return (words[type_index >> 6] >> (type_index & 63)) & 1;
+  }
+
+  // True when every bit of required is set here.
+  constexpr bool contains(const ComponentSignature& required) const {
+    uint64_t missing = 0;
+    for (int32_t w = 0; w < COMPONENT_SIGNATURE_WORDS; w++) {
+      missing |= required.words[w] & ~words[w];
+    }
+    return missing == 0;
+  }
+
+  constexpr bool empty() const {
+    uint64_t bits = 0;
+    for (int32_t w = 0; w < COMPONENT_SIGNATURE_WORDS; w++) {
+      bits |= words[w];
+    }
+    return bits == 0;
+  }
+
+  constexpr ComponentSignature operator|(const ComponentSignature& other) const {
+    ComponentSignature signature = {};
+    for (int32_t w = 0; w < COMPONENT_SIGNATURE_WORDS; w++) {
+      signature.words[w] = words[w] | other.words[w];
+    }
+    return signature;
+  }
+
+  constexpr ComponentSignature operator&(const ComponentSignature& other) const {
+    ComponentSignature signature = {};
+    for (int32_t w = 0; w < COMPONENT_SIGNATURE_WORDS; w++) {
+      signature.words[w] = words[w] & other.words[w];
+    }
+    return signature;
+  }
+
+  constexpr bool operator==(const ComponentSignature& other) const {
+    uint64_t different = 0;
+    for (int32_t w = 0; w < COMPONENT_SIGNATURE_WORDS; w++) {
+      different |= words[w] ^ other.words[w];
+    }
+    return different == 0;
+  }
+};
+
+template <typename T, typename First, typename... Rest> constexpr int32_t component_type_index() {
+  if constexpr (std::is_same_v<T, First>) {
+    return 0;
+  } else {
+    static_assert(sizeof...(Rest) > 0, "Component type is not part of the list");
+    return 1 + component_type_index<T, Rest...>();
+  }
+}
+
+// Dense array of one component type, what a registered component gets unless it specializes
+// ComponentStorageFor. T needs an EcsId entity_id member pointing back at its entity.
+template <typename T> struct ComponentArray {
+  static constexpr size_t SNAPSHOT_ROW_SIZE = sizeof(T);
+
+  T* items;
+  int32_t used;
+
+  bool init(System::MemoryArena* arena, int32_t capacity) {
+    items = System::arena_push<T>(arena, capacity, System::CACHE_LINE_SIZE);
+    used = 0;
+    return items != nullptr;
+  }
+
+  T& operator[](int32_t index) const {
+    ASSERT(index >= 0 && index < used);
+    return items[index];
+  }
+
+  EcsId entity_of(int32_t index) const {
+    return items[index].entity_id;
+  }
+
+  // Appends a value initialized component, returns its index.
+  int32_t push(EcsId entity_id) {
+    items[used] = T{};
+    items[used].entity_id = entity_id;
+    return used++;
+  }
+
+  void move(int32_t to, int32_t from) {
+    items[to] = items[from];
+  }
+
+  // items[i] = items[order[i]] for every component.
+  bool gather(const int32_t* order, System::MemoryArena* scratch_arena) {
+    System::ArenaScope scratch_scope(scratch_arena);
+
+    T* sorted = System::arena_push<T>(scratch_arena, System::max(used, 1));
+    if (!sorted) {
+      return false;
+    }
+
+    for (int32_t i = 0; i < used; i++) {
+      sorted[i] = items[order[i]];
+    }
+
+    memcpy(items, sorted, used * sizeof(T));
+    return true;
+  }
+
+  uint8_t* write_snapshot(uint8_t* cursor) const {
+    memcpy(cursor, items, used * sizeof(T));
+    return cursor + used * sizeof(T);
+  }
+
+  const uint8_t* read_snapshot(const uint8_t* cursor, int32_t count) {
+    memcpy(items, cursor, count * sizeof(T));
+    used = count;
+    return cursor + count * sizeof(T);
+  }
+};
+
+template <typename T> struct ComponentStorageFor {
+  using Type = ComponentArray<T>;
+};
+
+template <typename T> using ComponentStorage = typename ComponentStorageFor<T>::Type;
+
+// The component types an EntityComponentList stores, in TYPE_INDEX order. Storage is one
+// ComponentStorage<T> per type, and everything done to all components walks the list through for_each.
+template <typename... Ts> struct ComponentTypeList {
+  static constexpr int32_t COUNT = int32_t(sizeof...(Ts));
+  static_assert(COUNT <= MAX_COMPONENT_TYPES, "Widen ComponentSignature for more component types");
+
+  using Storage = std::tuple<ComponentStorage<Ts>...>;
+
+  template <typename T> static constexpr int32_t index_of() {
+    return component_type_index<T, Ts...>();
+  }
+
+  // Calls f.template operator()<T>() for every type, in TYPE_INDEX order.
+  template <typename F> static void for_each(F&& f) {
+    (f.template operator()<Ts>(), ...);
+  }
+};
+
+} //namespace
+} //namespace
@@ -8,18 +8,14 @@ namespace Asteroids {
 namespace Game {
 namespace Debug {
 
-void build_vertex_memory(System::MemoryArena* arena, Game::QTNode* node, int32_t& vertex_count) {
-  Math::V3* v = (Math::V3*)System::memory_arena_alloc(arena, 4, sizeof(Math::V3));
+Math::V3* build_vertex_memory(System::MemoryArena* arena, Game::QTNode* node, int32_t& vertex_count) {
+  Math::V3* v = System::arena_push<Math::V3>(arena, 4);
   ASSERT(v);
 
-  v[0].x = node->aabb.pos.x - node->aabb.half_edge;
-  v[0].y = node->aabb.pos.y + node->aabb.half_edge;
-  v[1].x = node->aabb.pos.x - node->aabb.half_edge;
-  v[1].y = node->aabb.pos.y - node->aabb.half_edge;
-  v[2].x = node->aabb.pos.x + node->aabb.half_edge;
-  v[2].y = node->aabb.pos.y - node->aabb.half_edge;
-  v[3].x = node->aabb.pos.x + node->aabb.half_edge;
-  v[3].y = node->aabb.pos.y + node->aabb.half_edge;
+  v[0] = {node->aabb.pos.x - node->aabb.half_edge, node->aabb.pos.y + node->aabb.half_edge, 0.0F};
+  v[1] = {node->aabb.pos.x - node->aabb.half_edge, node->aabb.pos.y - node->aabb.half_edge, 0.0F};
+  v[2] = {node->aabb.pos.x + node->aabb.half_edge, node->aabb.pos.y - node->aabb.half_edge, 0.0F};
+  v[3] = {node->aabb.pos.x + node->aabb.half_edge, node->aabb.pos.y + node->aabb.half_edge, 0.0F};
 
   vertex_count += 4;
 
@@ -38,23 +34,25 @@ void build_vertex_memory(System::MemoryArena* arena, Game::QTNode* node, int32_t
   if (node->se_child) {
     build_vertex_memory(arena, node->se_child, vertex_count);
   }
+
+  return v;
 }
 
-void render_quadtree(Game::QuadTree* qt) {
+void render_quadtree(Game::QuadTree* qt, System::MemoryArena* scratch_arena) {
   static uint32_t vao = uint32_t(-1);
   static uint32_t vbo = uint32_t(-1);
   static int32_t vertex_count = 0;
 
   if (vao == uint32_t(-1) || vbo == uint32_t(-1)) {
-    System::MemoryArena* arena = System::memory_arena_create("DBG_V", System::MB(1));
-    build_vertex_memory(arena, qt->root_, vertex_count);
+    System::ArenaScope scope(scratch_arena);
+    const Math::V3* vertices = build_vertex_memory(scratch_arena, qt->root_, vertex_count);
 
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
 
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Math::V3) * vertex_count, arena->bytes, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Math::V3) * vertex_count, vertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Math::V3), (GLvoid*)0);
     glBindVertexArray(0);
@@ -7,7 +7,7 @@ namespace Asteroids {
 namespace Game {
 namespace Debug {
 
-void render_quadtree(Game::QuadTree* qt);
+void render_quadtree(Game::QuadTree* qt, System::MemoryArena* scratch_arena);
 
 } //namespace
 } //namespace
@@ -1,10 +1,167 @@
 // ecs.cpp
 #include "ecs.h"
 
+#include "system/radix_sort.h"
+#include "math/morton.h"
+
 
 namespace Asteroids {
 namespace Game {
 
+// Sorts a component array by its entity's physics index, entities without physics go last.
+template <typename Storage>
+static bool follow_physics_order(Storage* storage, const Entity* entities, System::MemoryArena* scratch_arena) {
+  const int32_t used = storage->used;
+  if (used <= 1) {
+    return true;
+  }
+
+  System::ArenaScope scratch_scope(scratch_arena);
+
+  uint32_t* keys = System::arena_push<uint32_t>(scratch_arena, used);
+  int32_t* order = System::arena_push<int32_t>(scratch_arena, used);
+  if (!keys || !order) {
+    return false;
+  }
+
+  for (int32_t i = 0; i < used; i++) {
+    keys[i] = uint32_t(entities[storage->entity_of(i)].template index<PhysicsComponent>());
+  }
+
+  return System::radix_sort_indices(keys, used, order, scratch_arena) && storage->gather(order, scratch_arena);
+}
+
+bool PhysicsComponentArrays::init(System::MemoryArena* arena, int32_t capacity) {
+  float** float_arrays[] = {&pos_x, &pos_y, &half_edge, &vel_x, &vel_y, &acc_x, &acc_y, &orientation, &mass};
+
+  for (float** array : float_arrays) {
+    *array = System::arena_push<float>(arena, capacity, System::CACHE_LINE_SIZE);
+    if (!*array) {
+      return false;
+    }
+  }
+
+  entity_id = System::arena_push<EcsId>(arena, capacity, System::CACHE_LINE_SIZE);
+  used = 0;
+  return entity_id != nullptr;
+}
+
+PhysicsComponent PhysicsComponentArrays::get(int32_t index) const {
+  PhysicsComponent component;
+  component.aabb = aabb(index);
+  component.velocity = Math::V3{vel_x[index], vel_y[index], 0.0F};
+  component.acceleration = Math::V3{acc_x[index], acc_y[index], 0.0F};
+  component.orientation = orientation[index];
+  component.mass = mass[index];
+  component.entity_id = entity_id[index];
+  return component;
+}
+
+void PhysicsComponentArrays::set(int32_t index, const PhysicsComponent& component) {
+  pos_x[index] = component.aabb.pos.x;
+  pos_y[index] = component.aabb.pos.y;
+  half_edge[index] = component.aabb.half_edge;
+  vel_x[index] = component.velocity.x;
+  vel_y[index] = component.velocity.y;
+  acc_x[index] = component.acceleration.x;
+  acc_y[index] = component.acceleration.y;
+  orientation[index] = component.orientation;
+  mass[index] = component.mass;
+  entity_id[index] = component.entity_id;
+}
+
+void PhysicsComponentArrays::move(int32_t to, int32_t from) {
+  set(to, get(from));
+}
+
+int32_t PhysicsComponentArrays::push(EcsId entity) {
+  PhysicsComponent physics = {};
+  physics.aabb.half_edge = 0.0F;
+  physics.entity_id = entity;
+  set(used, physics);
+  return used++;
+}
+
+bool PhysicsComponentArrays::gather(const int32_t* order, System::MemoryArena* scratch_arena) {
+  System::ArenaScope scratch_scope(scratch_arena);
+
+  float* sorted = System::arena_push<float>(scratch_arena, System::max(used, 1));
+  if (!sorted) {
+    return false;
+  }
+
+  float* float_arrays[] = {pos_x, pos_y, half_edge, vel_x, vel_y, acc_x, acc_y, orientation, mass};
+
+  for (float* array : float_arrays) {
+    for (int32_t i = 0; i < used; i++) {
+      sorted[i] = array[order[i]];
+    }
+
+    memcpy(array, sorted, used * sizeof(float));
+  }
+
+  // EcsId and float share a size, the gather buffer is reused for the ids.
+  static_assert(sizeof(EcsId) == sizeof(float), "Physics gather buffer is shared with entity ids");
+  EcsId* sorted_ids = (EcsId*)sorted;
+  for (int32_t i = 0; i < used; i++) {
+    sorted_ids[i] = entity_id[order[i]];
+  }
+
+  memcpy(entity_id, sorted_ids, used * sizeof(EcsId));
+  return true;
+}
+
+uint8_t* PhysicsComponentArrays::write_snapshot(uint8_t* cursor) const {
+  const float* float_arrays[] = {pos_x, pos_y, half_edge, vel_x, vel_y, acc_x, acc_y, orientation, mass};
+
+  for (const float* array : float_arrays) {
+    memcpy(cursor, array, used * sizeof(float));
+    cursor += used * sizeof(float);
+  }
+
+  memcpy(cursor, entity_id, used * sizeof(EcsId));
+  return cursor + used * sizeof(EcsId);
+}
+
+const uint8_t* PhysicsComponentArrays::read_snapshot(const uint8_t* cursor, int32_t count) {
+  float* float_arrays[] = {pos_x, pos_y, half_edge, vel_x, vel_y, acc_x, acc_y, orientation, mass};
+
+  for (float* array : float_arrays) {
+    memcpy(array, cursor, count * sizeof(float));
+    cursor += count * sizeof(float);
+  }
+
+  memcpy(entity_id, cursor, count * sizeof(EcsId));
+  used = count;
+  return cursor + count * sizeof(EcsId);
+}
+
+template <typename T> void EntityComponentList::add_component(Entity* entity) {
+  constexpr int32_t type_index = ComponentTraits<T>::TYPE_INDEX;
+  ASSERT(!entity->signature.test(type_index));
+
+  entity->component_idx[type_index] = components<T>().push(entity->entity_id);
+  entity->signature.set(type_index);
+  mark_changed<T>(entity->entity_id);
+}
+
+// Moves the last component into the removed slot and points its entity at the new index.
+template <typename T> void EntityComponentList::remove_component(Entity* entity) {
+  constexpr int32_t type_index = ComponentTraits<T>::TYPE_INDEX;
+  ComponentStorage<T>& storage = components<T>();
+
+  const int32_t index = entity->component_idx[type_index];
+  ASSERT(index >= 0 && index < storage.used);
+
+  const int32_t last = --storage.used;
+  if (index != last) {
+    storage.move(index, last);
+    entities[storage.entity_of(index)].component_idx[type_index] = index;
+  }
+
+  entity->component_idx[type_index] = ECSID_NOT_INITIALIZED;
+}
+
 bool EntityComponentList::init(System::MemoryArena* arena, int32_t max_entities) {
   ASSERT(arena && arena->allocated_size > 0);
   if (!arena || !arena->allocated_size) {
@@ -14,67 +171,608 @@ bool EntityComponentList::init(System::MemoryArena* arena, int32_t max_entities)
   entity_arena = arena;
   max_entities_ = max_entities;
 
-  entities = (Entity*)System::memory_arena_alloc(entity_arena, max_entities_, sizeof(Entity));
-  ASSERT(entities);
-  if (!entities) {
+  static_assert(System::Pool<Entity>::SLOT_SIZE == sizeof(Entity), "Entity pool slots must be indexable as an array");
+  if (!entity_pool_.init(entity_arena, max_entities_)) {
     return false;
   }
 
-  render_components = (RenderComponent*)System::memory_arena_alloc(entity_arena, max_entities_, sizeof(RenderComponent));
-  ASSERT(render_components);
-  if (!render_components) {
+  entities = entity_pool_.items();
+
+  entity_generations_ = (uint32_t*)System::memory_arena_alloc_zeroed(entity_arena, max_entities_, sizeof(uint32_t));
+  if (!entity_generations_) {
     return false;
   }
 
-  physics_components = (PhysicsComponent*)System::memory_arena_alloc(entity_arena, max_entities_, sizeof(PhysicsComponent));
-  ASSERT(physics_components);
-  if (!physics_components) {
+  bool components_allocated = true;
+  ComponentRegistry::for_each([this, &components_allocated]<typename T>() {
+    components_allocated = components_allocated && components<T>().init(entity_arena, max_entities_);
+  });
+
+  ASSERT(components_allocated);
+  if (!components_allocated) {
     return false;
   }
 
-  sound_components = (SoundComponent*)System::memory_arena_alloc(entity_arena, max_entities_, sizeof(SoundComponent));
-  ASSERT(sound_components);
-  if (!sound_components) {
+  if (!destroyed_entities_.init(entity_arena, max_entities_)) {
     return false;
   }
 
+  for (System::ArenaBitSet& changed : changed_) {
+    if (!changed.init(entity_arena, max_entities_)) {
+      return false;
+    }
+  }
+
   return true;
 }
 
 void EntityComponentList::finalize() {
-
+  entity_pool_.log_stats("ENTITY");
 }
 
-Entity* EntityComponentList::create_entity(int components) {
-  ASSERT(entities_used < max_entities_);
+Entity* EntityComponentList::create_entity(ComponentSignature signature) {
+  Entity* entity = entity_pool_.alloc();
+  ASSERT(entity);
+  if (!entity) {
+    return nullptr;
+  }
 
-  const int32_t new_entity_idx = entities_used++;
+  const int32_t new_entity_idx = entity_pool_.index_of(entity);
+  entities_used = entity_pool_.slot_count();
 
-  Entity* entity = &entities[new_entity_idx];
   entity->entity_id = new_entity_idx;
-  entity->physics_component_idx = ECSID_NOT_INITIALIZED;
-  entity->render_component_idx = ECSID_NOT_INITIALIZED;
-  entity->sound_component_idx = ECSID_NOT_INITIALIZED;
+  entity->defunct = false;
+  entity->signature = ComponentSignature::none();
+  for (EcsId& component_idx : entity->component_idx) {
+    component_idx = ECSID_NOT_INITIALIZED;
+  }
+
+  ComponentRegistry::for_each([this, entity, signature]<typename T>() {
+    if (signature.test(ComponentTraits<T>::TYPE_INDEX)) {
+      add_component<T>(entity);
+    }
+  });
+
+  return entity;
+}
+
+// Entities are spawned in chunks, a chunk's ids stay in L1 while every array of the batch takes its range.
+constexpr int32_t SPAWN_BATCH_CHUNK = 1024;
+
+// What the prefab sets on a value initialized component, every row of a batch starts as a copy of it.
+template <typename T> static T prefab_row(const Prefab*) {
+  return T{};
+}
 
-  if (components & RENDER_COMPONENT) {
-    const int32_t render_component_idx = render_components_used++;
-    entity->render_component_idx = render_component_idx;
-    render_components[render_component_idx].entity_id = new_entity_idx;
+template <> RenderComponent prefab_row<RenderComponent>(const Prefab* prefab) {
+  RenderComponent render = {};
+  render.transform.rotation = prefab->orientation;
+  render.vertex_array_idx = prefab->vertex_array_idx;
+  return render;
+}
+
+template <> SoundComponent prefab_row<SoundComponent>(const Prefab* prefab) {
+  SoundComponent sound = {};
+  memcpy(sound.sound_indecies, prefab->sound_indecies, sizeof(prefab->sound_indecies));
+  return sound;
+}
+
+template <typename T> static void fill_batch_rows(ComponentArray<T>* storage, int32_t first,
+  const EcsId* entity_ids, int32_t count, const Prefab* prefab) {
+  const T row = prefab_row<T>(prefab);
+  for (int32_t i = 0; i < count; i++) {
+    storage->items[first + i] = row;
+    storage->items[first + i].entity_id = entity_ids[i];
   }
+}
+
+static void fill_batch_rows(PhysicsComponentArrays* physics, int32_t first,
+  const EcsId* entity_ids, int32_t count, const Prefab* prefab) {
+  // One array at a time, the compiler turns each of these into wide stores.
+  auto fill = [first, count](float* values, float value) {
+    for (int32_t i = first; i < first + count; i++) {
+      values[i] = value;
+    }
+  };
+
+  fill(physics->pos_x, 0.0F);
+  fill(physics->pos_y, 0.0F);
+  fill(physics->half_edge, prefab->half_edge);
+  fill(physics->vel_x, prefab->velocity.x);
+  fill(physics->vel_y, prefab->velocity.y);
+  fill(physics->acc_x, 0.0F);
+  fill(physics->acc_y, 0.0F);
+  fill(physics->orientation, prefab->orientation);
+  fill(physics->mass, prefab->mass);
+  memcpy(physics->entity_id + first, entity_ids, count * sizeof(EcsId));
+}
+
+SpawnBatch EntityComponentList::spawn_batch(const Prefab* prefab, int32_t count) {
+  ASSERT(prefab && count >= 0);
 
-  if (components & PHYSICS_COMPONENT) {
-    const int32_t physics_component_idx = physics_components_used++;
-    entity->physics_component_idx = physics_component_idx;
-    physics_components[physics_component_idx].entity_id = new_entity_idx;
+  const int32_t available = entity_pool_.capacity() - entity_pool_.live_count();
+  if (count > available) {
+    System::log_error("Entity pool exhausted, spawning %d of %d", available, count);
+    count = available;
   }
 
-  if (components & SOUND_COMPONENT) {
-    const int32_t sound_component_idx = sound_components_used++;
-    entity->sound_component_idx = sound_component_idx;
-    sound_components[sound_component_idx].entity_id = new_entity_idx;
+  const ComponentSignature signature = prefab->components;
+
+  // Component ranges are reserved up front, every array of the batch is one contiguous range.
+  EcsId first_idx[COMPONENT_TYPE_COUNT];
+  EcsId idx_step[COMPONENT_TYPE_COUNT];
+  ComponentRegistry::for_each([this, signature, count, &first_idx, &idx_step]<typename T>() {
+    constexpr int32_t type_index = ComponentTraits<T>::TYPE_INDEX;
+    first_idx[type_index] = ECSID_NOT_INITIALIZED;
+    idx_step[type_index] = 0;
+
+    if (signature.test(type_index)) {
+      first_idx[type_index] = components<T>().used;
+      idx_step[type_index] = 1;
+      components<T>().used += count;
+    }
+  });
+
+  // Every record is a copy of this one with its own id and component indices.
+  Entity prototype;
+  memset(&prototype, 0, sizeof(prototype));
+  prototype.signature = signature;
+
+  EcsId entity_ids[SPAWN_BATCH_CHUNK];
+  for (int32_t done = 0; done < count; done += SPAWN_BATCH_CHUNK) {
+    const int32_t chunk = System::min(count - done, SPAWN_BATCH_CHUNK);
+    const int32_t allocated = entity_pool_.alloc_batch(chunk, entity_ids);
+    ASSERT(allocated == chunk);
+
+    for (int32_t i = 0; i < chunk; i++) {
+      Entity* entity = &entities[entity_ids[i]];
+      memcpy(entity, &prototype, sizeof(prototype));
+      entity->entity_id = entity_ids[i];
+      for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+        entity->component_idx[t] = first_idx[t] + idx_step[t] * (done + i);
+      }
+    }
+
+    ComponentRegistry::for_each([this, signature, prefab, &first_idx, &entity_ids, done, chunk]<typename T>() {
+      constexpr int32_t type_index = ComponentTraits<T>::TYPE_INDEX;
+      if (signature.test(type_index)) {
+        fill_batch_rows(&components<T>(), first_idx[type_index] + done, entity_ids, chunk, prefab);
+      }
+    });
+
+    // Fresh slots come out as one ascending run of ids, their change bits are set a word at a time.
+    int32_t run_begin = 0;
+    for (int32_t i = 1; i <= chunk; i++) {
+      if (i < chunk && entity_ids[i] == entity_ids[i - 1] + 1) {
+        continue;
+      }
+
+      for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+        if (signature.test(t)) {
+          changed_[t].set_range(entity_ids[run_begin], entity_ids[i - 1] + 1);
+        }
+      }
+
+      run_begin = i;
+    }
   }
 
-  return entity;
+  entities_used = entity_pool_.slot_count();
+
+  return SpawnBatch{count, first_idx[ComponentTraits<PhysicsComponent>::TYPE_INDEX],
+    first_idx[ComponentTraits<RenderComponent>::TYPE_INDEX], first_idx[ComponentTraits<SoundComponent>::TYPE_INDEX]};
+}
+
+LifetimeComponent* EntityComponentList::add_lifetime_component(EcsId entity_id, int64_t lifetime_ms) {
+  ASSERT(entity_id >= 0 && entity_id < entities_used);
+
+  Entity* entity = &entities[entity_id];
+  ASSERT(!entity->defunct);
+
+  if (!entity->has<LifetimeComponent>()) {
+    add_component<LifetimeComponent>(entity);
+  }
+
+  LifetimeComponent* lifetime = &components<LifetimeComponent>()[entity->index<LifetimeComponent>()];
+  lifetime->lifetime_ms = lifetime_ms;
+  mark_changed<LifetimeComponent>(entity_id);
+  return lifetime;
+}
+
+void EntityComponentList::mark_moving_changed() {
+  const PhysicsComponentArrays& physics = components<PhysicsComponent>();
+  System::ArenaBitSet* physics_changed = &changed_[ComponentTraits<PhysicsComponent>::TYPE_INDEX];
+
+  for (int32_t i = 0; i < physics.used; i++) {
+    if (physics.vel_x[i] != 0.0F || physics.vel_y[i] != 0.0F) {
+      physics_changed->set(physics.entity_id[i]);
+    }
+  }
+}
+
+void EntityComponentList::clear_changes() {
+  for (System::ArenaBitSet& changed : changed_) {
+    changed.clear();
+  }
+}
+
+void EntityComponentList::destroy_entity(EcsId entity_id) {
+  ASSERT(entity_id >= 0 && entity_id < entities_used);
+
+  Entity* entity = &entities[entity_id];
+  if (entity->defunct) {
+    return;
+  }
+
+  entity->defunct = true;
+  destroyed_entities_.push(entity_id);
+}
+
+void EntityComponentList::destroy_entity(EntityHandle handle) {
+  if (is_valid(handle)) {
+    destroy_entity(handle.index);
+  }
+}
+
+void EntityComponentList::compact() {
+  for (const EcsId entity_id : destroyed_entities_) {
+    Entity* entity = &entities[entity_id];
+
+    ComponentRegistry::for_each([this, entity]<typename T>() {
+      if (entity->has<T>()) {
+        remove_component<T>(entity);
+      }
+    });
+
+    for (System::ArenaBitSet& changed : changed_) {
+      changed.reset(entity_id);
+    }
+
+    // The free slot keeps defunct set so loops over entities skip it until it is reused.
+    entity_pool_.free(entity);
+    entity_generations_[entity_id]++;
+  }
+
+  destroyed_entities_.clear();
+}
+
+bool EntityComponentList::sort_spatially(System::MemoryArena* scratch_arena) {
+  ASSERT(scratch_arena);
+  ASSERT(destroyed_entities_.empty());
+
+  PhysicsComponentArrays* physics = &components<PhysicsComponent>();
+  const int32_t used = physics->used;
+  if (used <= 1) {
+    return true;
+  }
+
+  {
+    System::ArenaScope scratch_scope(scratch_arena);
+
+    uint32_t* keys = System::arena_push<uint32_t>(scratch_arena, used);
+    int32_t* order = System::arena_push<int32_t>(scratch_arena, used);
+    if (!keys || !order) {
+      return false;
+    }
+
+    float min_x = physics->pos_x[0];
+    float min_y = physics->pos_y[0];
+    float max_x = min_x;
+    float max_y = min_y;
+
+    for (int32_t i = 1; i < used; i++) {
+      min_x = fminf(min_x, physics->pos_x[i]);
+      min_y = fminf(min_y, physics->pos_y[i]);
+      max_x = fmaxf(max_x, physics->pos_x[i]);
+      max_y = fmaxf(max_y, physics->pos_y[i]);
+    }
+
+    const float extent = fmaxf(max_x - min_x, max_y - min_y);
+    for (int32_t i = 0; i < used; i++) {
+      keys[i] = Math::morton_code(physics->pos_x[i], physics->pos_y[i], min_x, min_y, extent);
+    }
+
+    if (!System::radix_sort_indices(keys, used, order, scratch_arena) || !physics->gather(order, scratch_arena)) {
+      return false;
+    }
+  }
+
+  // Physics first, every other array sorts by the physics index its entity now has.
+  bool sorted = true;
+  ComponentRegistry::for_each([this, &sorted, scratch_arena]<typename T>() {
+    ComponentStorage<T>* storage = &components<T>();
+    if constexpr (!std::is_same_v<T, PhysicsComponent>) {
+      sorted = sorted && follow_physics_order(storage, entities, scratch_arena);
+    }
+
+    for (int32_t i = 0; i < storage->used; i++) {
+      entities[storage->entity_of(i)].component_idx[ComponentTraits<T>::TYPE_INDEX] = i;
+    }
+  });
+
+  return sorted;
+}
+
+static uint8_t* write_snapshot_array(uint8_t* cursor, const void* source, size_t size) {
+  memcpy(cursor, source, size);
+  return cursor + size;
+}
+
+static const uint8_t* read_snapshot_array(const uint8_t* cursor, void* destination, size_t size) {
+  memcpy(destination, cursor, size);
+  return cursor + size;
+}
+
+// Header with the layout of this build filled in, counts are left to the caller.
+static EcsSnapshotHeader ecs_snapshot_layout() {
+  EcsSnapshotHeader header = {};
+  header.magic = ECS_SNAPSHOT_MAGIC;
+  header.version = ECS_SNAPSHOT_VERSION;
+  header.entity_slot_size = uint32_t(System::Pool<Entity>::SLOT_SIZE);
+  header.component_type_count = COMPONENT_TYPE_COUNT;
+
+  ComponentRegistry::for_each([&header]<typename T>() {
+    header.component_row_sizes[ComponentTraits<T>::TYPE_INDEX] = uint32_t(ComponentStorage<T>::SNAPSHOT_ROW_SIZE);
+  });
+
+  return header;
+}
+
+static size_t ecs_snapshot_size(const EcsSnapshotHeader& header) {
+  size_t size = sizeof(EcsSnapshotHeader)
+    + header.entity_slot_count * System::Pool<Entity>::SLOT_SIZE
+    + header.entity_slot_count * sizeof(uint32_t);
+
+  for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+    size += header.component_counts[t] * size_t(header.component_row_sizes[t]);
+  }
+
+  return size;
+}
+
+size_t EntityComponentList::snapshot_size() const {
+  EcsSnapshotHeader header = ecs_snapshot_layout();
+  header.entity_slot_count = entity_pool_.slot_count();
+
+  ComponentRegistry::for_each([this, &header]<typename T>() {
+    header.component_counts[ComponentTraits<T>::TYPE_INDEX] = components<T>().used;
+  });
+
+  return ecs_snapshot_size(header);
+}
+
+size_t EntityComponentList::max_snapshot_size() const {
+  EcsSnapshotHeader header = ecs_snapshot_layout();
+  header.entity_slot_count = max_entities_;
+
+  for (int32_t& count : header.component_counts) {
+    count = max_entities_;
+  }
+
+  return ecs_snapshot_size(header);
+}
+
+size_t EntityComponentList::write_snapshot(uint8_t* out, size_t capacity) const {
+  ASSERT(out);
+  ASSERT(destroyed_entities_.empty());
+
+  const size_t size = snapshot_size();
+  if (size > capacity) {
+    System::log_error("ECS snapshot needs %zu bytes, buffer holds %zu", size, capacity);
+    return 0;
+  }
+
+  EcsSnapshotHeader header = ecs_snapshot_layout();
+  header.entity_slot_count = entity_pool_.slot_count();
+  header.entity_live_count = entity_pool_.live_count();
+  header.entity_free_head = entity_pool_.free_head();
+
+  ComponentRegistry::for_each([this, &header]<typename T>() {
+    header.component_counts[ComponentTraits<T>::TYPE_INDEX] = components<T>().used;
+  });
+
+  uint8_t* cursor = write_snapshot_array(out, &header, sizeof(header));
+  cursor = write_snapshot_array(cursor, entities, header.entity_slot_count * System::Pool<Entity>::SLOT_SIZE);
+  cursor = write_snapshot_array(cursor, entity_generations_, header.entity_slot_count * sizeof(uint32_t));
+
+  ComponentRegistry::for_each([this, &cursor]<typename T>() {
+    cursor = components<T>().write_snapshot(cursor);
+  });
+
+  ASSERT(size_t(cursor - out) == size);
+  return size;
+}
+
+size_t EntityComponentList::validate_snapshot(const uint8_t* bytes, size_t size, EcsSnapshotHeader* out_header) const {
+  ASSERT(bytes && out_header);
+
+  EcsSnapshotHeader header = {};
+  if (size < sizeof(header)) {
+    System::log_error("ECS snapshot is truncated");
+    return 0;
+  }
+
+  memcpy(&header, bytes, sizeof(header));
+
+  if (header.magic != ECS_SNAPSHOT_MAGIC || header.version != ECS_SNAPSHOT_VERSION) {
+    System::log_error("ECS snapshot version %u is not supported", header.version);
+    return 0;
+  }
+
+  const EcsSnapshotHeader layout = ecs_snapshot_layout();
+  if (header.entity_slot_size != layout.entity_slot_size || header.component_type_count != layout.component_type_count
+    || memcmp(header.component_row_sizes, layout.component_row_sizes, sizeof(layout.component_row_sizes)) != 0) {
+    System::log_error("ECS snapshot was written with different component layouts");
+    return 0;
+  }
+
+  bool counts_fit = header.entity_slot_count >= 0 && header.entity_slot_count <= max_entities_
+    && header.entity_live_count >= 0 && header.entity_live_count <= header.entity_slot_count;
+
+  for (const int32_t count : header.component_counts) {
+    counts_fit = counts_fit && count >= 0 && count <= max_entities_;
+  }
+
+  if (!counts_fit) {
+    System::log_error("ECS snapshot holds %d entities, the list is sized for %d", header.entity_slot_count, max_entities_);
+    return 0;
+  }
+
+  const size_t snapshot_bytes = ecs_snapshot_size(header);
+  if (snapshot_bytes > size) {
+    System::log_error("ECS snapshot is truncated, %zu of %zu bytes", size, snapshot_bytes);
+    return 0;
+  }
+
+  ComponentSignature registered = ComponentSignature::none();
+  ComponentRegistry::for_each([&registered]<typename T>() {
+    registered = registered | ComponentTraits<T>::SIGNATURE;
+  });
+
+  // Live entities must sit in their own slot and index inside the loaded component counts, one row each.
+  const uint8_t* entity_bytes = bytes + sizeof(header);
+  int32_t live_count = 0;
+  int32_t component_rows[COMPONENT_TYPE_COUNT] = {};
+
+  for (int32_t i = 0; i < header.entity_slot_count; i++) {
+    Entity entity;
+    memcpy(&entity, entity_bytes + i * System::Pool<Entity>::SLOT_SIZE, sizeof(entity));
+    if (entity.defunct) {
+      continue;
+    }
+
+    bool entity_valid = entity.entity_id == i && registered.contains(entity.signature);
+    for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+      if (entity.signature.test(t)) {
+        entity_valid = entity_valid && entity.component_idx[t] >= 0 && entity.component_idx[t] < header.component_counts[t];
+        component_rows[t]++;
+      }
+    }
+
+    if (!entity_valid) {
+      System::log_error("ECS snapshot entity %d is corrupt", i);
+      return 0;
+    }
+
+    live_count++;
+  }
+
+  bool rows_match = live_count == header.entity_live_count;
+  for (int32_t t = 0; t < COMPONENT_TYPE_COUNT; t++) {
+    rows_match = rows_match && component_rows[t] == header.component_counts[t];
+  }
+
+  if (!rows_match) {
+    System::log_error("ECS snapshot entity and component counts disagree");
+    return 0;
+  }
+
+  // Free slots are defunct and chained from the free head, every one of them exactly once.
+  const int32_t free_count = header.entity_slot_count - header.entity_live_count;
+  int32_t free_slot = header.entity_free_head;
+  int32_t chained = 0;
+
+  while (free_slot != System::Pool<Entity>::NONE && chained < free_count
+    && free_slot >= 0 && free_slot < header.entity_slot_count) {
+    const uint8_t* slot_bytes = entity_bytes + free_slot * System::Pool<Entity>::SLOT_SIZE;
+
+    Entity entity;
+    memcpy(&entity, slot_bytes, sizeof(entity));
+    if (!entity.defunct) {
+      break;
+    }
+
+    memcpy(&free_slot, slot_bytes, sizeof(free_slot));
+    chained++;
+  }
+
+  if (free_slot != System::Pool<Entity>::NONE || chained != free_count) {
+    System::log_error("ECS snapshot free list is corrupt");
+    return 0;
+  }
+
+  *out_header = header;
+  return snapshot_bytes;
+}
+
+void EntityComponentList::reset() {
+  entity_pool_.restore(0, 0, System::Pool<Entity>::NONE);
+  entities_used = 0;
+  memset(entity_generations_, 0, max_entities_ * sizeof(uint32_t));
+
+  ComponentRegistry::for_each([this]<typename T>() {
+    components<T>().used = 0;
+  });
+
+  destroyed_entities_.clear();
+  clear_changes();
+}
+
+bool EntityComponentList::snapshot_entity(const uint8_t* bytes, const EcsSnapshotHeader& header,
+  EcsId entity_id, Entity* entity) {
+  ASSERT(bytes && entity);
+
+  if (entity_id < 0 || entity_id >= header.entity_slot_count) {
+    return false;
+  }
+
+  memcpy(entity, bytes + sizeof(header) + entity_id * System::Pool<Entity>::SLOT_SIZE, sizeof(Entity));
+  return true;
+}
+
+size_t EntityComponentList::read_snapshot(const uint8_t* bytes, size_t size) {
+  EcsSnapshotHeader header = {};
+  const size_t snapshot_bytes = validate_snapshot(bytes, size, &header);
+  if (snapshot_bytes == 0) {
+    return 0;
+  }
+
+  const uint8_t* cursor = bytes + sizeof(header);
+  cursor = read_snapshot_array(cursor, entities, header.entity_slot_count * System::Pool<Entity>::SLOT_SIZE);
+  cursor = read_snapshot_array(cursor, entity_generations_, header.entity_slot_count * sizeof(uint32_t));
+
+  ComponentRegistry::for_each([this, &cursor, &header]<typename T>() {
+    cursor = components<T>().read_snapshot(cursor, header.component_counts[ComponentTraits<T>::TYPE_INDEX]);
+  });
+
+  entity_pool_.restore(header.entity_slot_count, header.entity_live_count, header.entity_free_head);
+  entities_used = header.entity_slot_count;
+  destroyed_entities_.clear();
+
+  // Every row must belong to the live entity that indexes it, the validated counts make that one to one.
+  bool rows_owned = true;
+  ComponentRegistry::for_each([this, &rows_owned]<typename T>() {
+    const ComponentStorage<T>& storage = components<T>();
+    for (int32_t i = 0; i < storage.used && rows_owned; i++) {
+      const EcsId owner = storage.entity_of(i);
+      rows_owned = owner >= 0 && owner < entities_used && !entities[owner].defunct
+        && entities[owner].has<T>() && entities[owner].index<T>() == i;
+    }
+  });
+
+  if (!rows_owned) {
+    System::log_error("ECS snapshot components do not match their entities");
+    reset();
+    return 0;
+  }
+
+  // Everything loaded is new to the systems that consume changes.
+  clear_changes();
+  for (int32_t i = 0; i < entities_used; i++) {
+    const Entity* entity = &entities[i];
+    if (entity->defunct) {
+      continue;
+    }
+
+    ComponentRegistry::for_each([this, entity, i]<typename T>() {
+      if (entity->has<T>()) {
+        mark_changed<T>(i);
+      }
+    });
+  }
+
+  ASSERT(size_t(cursor - bytes) == snapshot_bytes);
+  return snapshot_bytes;
 }
 
 } //namespace
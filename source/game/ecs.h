@@ -3,40 +3,35 @@
 
 #include "system/system.h"
 #include "system/memory.h"
+#include "system/pool.h"
+#include "system/containers.h"
 #include "math/vector3.h"
 #include "math/matrix4.h"
+#include "math/transform.h"
 #include "math/aabb.h"
 
+#include "component_registry.h"
+
 namespace Asteroids {
 namespace Game {
 
-using EcsId = int32_t;
-constexpr EcsId ECSID_NOT_INITIALIZED = -1;
-constexpr int32_t MAX_SOUND_COMPONENT_SOUNDS = 4;
-
-enum EntityComponentTypes {
-  LIFETIME_COMPONENT = 1,
-  PHYSICS_COMPONENT = 2,
-  RENDER_COMPONENT = 3,
-  SOUND_COMPONENT = 4,
-};
-
-struct Entity {
-  EcsId entity_id;
-  EcsId render_component_idx;
-  EcsId physics_component_idx;
-  EcsId sound_component_idx;
-  EcsId lifetime_component_idx;
-  bool defunct;
+// Entity slots are recycled, a handle stays valid only while the slot holds the same generation.
+// Keep handles, not bare ids, anywhere an entity can be referenced across frames.
+struct EntityHandle {
+  EcsId index;
+  uint32_t generation;
 };
 
+constexpr EntityHandle ENTITY_HANDLE_NONE = {ECSID_NOT_INITIALIZED, 0};
+constexpr int32_t MAX_SOUND_COMPONENT_SOUNDS = 4;
 struct RenderComponent {
-  Math::M4 world_transform;
+  Math::Transform2D transform = Math::TRANSFORM_2D_IDENTITY;
   int32_t vertex_array_idx;
   int32_t texture_idx;
   EcsId entity_id;
 };
 
+// By-value view of one physics entry, see PhysicsComponentArrays::get() / set().
 struct PhysicsComponent {
   Math::AABB aabb;
   Math::V3 velocity;
@@ -46,16 +41,139 @@ struct PhysicsComponent {
   EcsId entity_id;
 };
 
+// Physics is stored as structure of arrays so integration and AABB tests stream contiguous floats.
+// Everything moves in the XY plane, z is not stored and reads back as zero.
+// Also the ComponentStorage of PhysicsComponent, so it has the same interface as ComponentArray.
+struct PhysicsComponentArrays {
+  static constexpr size_t SNAPSHOT_ROW_SIZE = 9 * sizeof(float) + sizeof(EcsId);
+
+  float* pos_x;
+  float* pos_y;
+  float* half_edge;
+  float* vel_x;
+  float* vel_y;
+  float* acc_x;
+  float* acc_y;
+  float* orientation;
+  float* mass;
+  EcsId* entity_id;
+  int32_t used;
+
+  bool init(System::MemoryArena* arena, int32_t capacity);
+
+  PhysicsComponent get(int32_t index) const;
+  void set(int32_t index, const PhysicsComponent& component);
+  void move(int32_t to, int32_t from);
+
+  EcsId entity_of(int32_t index) const {
+    return entity_id[index];
+  }
+
+  int32_t push(EcsId entity);
+  bool gather(const int32_t* order, System::MemoryArena* scratch_arena);
+  uint8_t* write_snapshot(uint8_t* cursor) const;
+  const uint8_t* read_snapshot(const uint8_t* cursor, int32_t count);
+
+  Math::V3 position(int32_t index) const {
+    return Math::V3{pos_x[index], pos_y[index], 0.0F};
+  }
+
+  Math::AABB aabb(int32_t index) const {
+    return Math::AABB{position(index), half_edge[index]};
+  }
+};
+
 struct SoundComponent {
   int32_t sound_indecies[MAX_SOUND_COMPONENT_SOUNDS];
   EcsId entity_id;
 };
 
+// lifetime_ms is what the entity was given, LifetimeSystem tracks when it runs out.
 struct LifetimeComponent {
   int64_t lifetime_ms;
   EcsId entity_id;
 };
 
+template <> struct ComponentStorageFor<PhysicsComponent> {
+  using Type = PhysicsComponentArrays;
+};
+
+// Every component type an entity can have. A new type is a struct with an EcsId entity_id member appended
+// here, its storage, signature bit, change tracking and snapshot section all follow from the list.
+using ComponentRegistry = ComponentTypeList<LifetimeComponent, PhysicsComponent, RenderComponent, SoundComponent>;
+constexpr int32_t COMPONENT_TYPE_COUNT = ComponentRegistry::COUNT;
+
+template <typename T> struct ComponentTraits {
+  static constexpr int32_t TYPE_INDEX = ComponentRegistry::index_of<T>();
+  static constexpr ComponentSignature SIGNATURE = ComponentSignature::of(TYPE_INDEX);
+};
+
+template <typename... Ts> constexpr ComponentSignature component_signature() {
+  return (ComponentSignature::none() | ... | ComponentTraits<Ts>::SIGNATURE);
+}
+
+constexpr ComponentSignature LIFETIME_COMPONENT = component_signature<LifetimeComponent>();
+constexpr ComponentSignature PHYSICS_COMPONENT = component_signature<PhysicsComponent>();
+constexpr ComponentSignature RENDER_COMPONENT = component_signature<RenderComponent>();
+constexpr ComponentSignature SOUND_COMPONENT = component_signature<SoundComponent>();
+
+// component_idx is the sparse to dense map into each component array, components point back through
+// entity_id. signature has a bit set for every component the entity has.
+struct Entity {
+  EcsId entity_id;
+  bool defunct;
+  ComponentSignature signature;
+  EcsId component_idx[COMPONENT_TYPE_COUNT];
+
+  template <typename T> bool has() const {
+    return signature.test(ComponentTraits<T>::TYPE_INDEX);
+  }
+
+  // ECSID_NOT_INITIALIZED when the entity lacks the component.
+  template <typename T> EcsId index() const {
+    return component_idx[ComponentTraits<T>::TYPE_INDEX];
+  }
+};
+
+constexpr uint32_t ECS_SNAPSHOT_MAGIC = 0x53434541; // "AECS"
+constexpr uint32_t ECS_SNAPSHOT_VERSION = 3;
+
+// Snapshots are raw component memory, they load back only into a build with the same component layouts.
+struct EcsSnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entity_slot_size;
+  int32_t entity_slot_count;
+  int32_t entity_live_count;
+  int32_t entity_free_head;
+  int32_t component_type_count;
+  uint32_t component_row_sizes[COMPONENT_TYPE_COUNT]; // Indexed by TYPE_INDEX
+  int32_t component_counts[COMPONENT_TYPE_COUNT];
+};
+
+// Component values shared by every entity spawned from it, built once per entity type so spawning does
+// not go back to the mesh. Only the components in the signature are created.
+struct Prefab {
+  ComponentSignature components;
+  int32_t vertex_array_idx;
+  int32_t sound_indecies[MAX_SOUND_COMPONENT_SOUNDS];
+  float half_edge;
+  float orientation;
+  Math::V3 velocity;
+  float mass;
+};
+
+// Component index ranges written by one spawn_batch call. Every component of a batch is contiguous,
+// entity ids are not, they come from the entity pool.
+struct SpawnBatch {
+  int32_t count;
+  int32_t first_physics_idx;
+  int32_t first_render_idx;
+  int32_t first_sound_idx;
+};
+
+template <typename... Ts> class EntityView;
+
 class EntityComponentList final {
   DISABLE_COPY_AND_MOVE(EntityComponentList);
 public:
@@ -65,28 +183,230 @@ public:
   bool init(System::MemoryArena* arena, int32_t max_entity_count);
   void finalize();
 
-  Entity* create_entity(int components);
+  Entity* create_entity(ComponentSignature signature);
+
+  // Creates count entities from prefab. Entity slots and component ranges are reserved up front, then each
+  // array is written once over its new range and change bits are set a word at a time.
+  // Creates fewer when the entity pool runs out, batch.count says how many.
+  SpawnBatch spawn_batch(const Prefab* prefab, int32_t count);
+
+  // Same, then calls generator(physics, begin, end) once over the new range of physics components to set
+  // per entity values such as the position.
+  template <typename F> SpawnBatch spawn_batch(const Prefab* prefab, int32_t count, F&& generator) {
+    const SpawnBatch batch = spawn_batch(prefab, count);
+    if (batch.first_physics_idx != ECSID_NOT_INITIALIZED) {
+      generator(&components<PhysicsComponent>(), batch.first_physics_idx, batch.first_physics_idx + batch.count);
+    }
+    return batch;
+  }
+
+  // Lifetimes are attached after creation, the expiry itself is tracked by LifetimeSystem.
+  LifetimeComponent* add_lifetime_component(EcsId entity_id, int64_t lifetime_ms);
+
+  // Destruction is deferred, the entity is marked defunct and its components stay in place until compact()
+  // swap-removes them at the end of the frame. Component arrays are dense again afterwards.
+  void destroy_entity(EcsId entity_id);
+  void destroy_entity(EntityHandle handle);
+  void compact();
+
+  int32_t destroyed_count() const { return destroyed_entities_.size(); }
+  const System::ArenaArray<EcsId>& destroyed_entities() const { return destroyed_entities_; }
+
+  // Reorders the physics components by the Morton code of their position inside the bounds of all of them,
+  // and every other component array to follow its entity's physics order. Entity ids and handles stay
+  // valid, component indices change. Call after compact(), temporaries come from scratch_arena.
+  bool sort_spatially(System::MemoryArena* scratch_arena);
+
+  // Change tracking, one bit set per component type indexed by entity id so it survives swap-removes and
+  // sorting. Creation marks every component of the entity, writers mark what they modify and consumers
+  // visit only marked entities. clear_changes() starts the next frame.
+  template <typename T> void mark_changed(EcsId entity_id) {
+    changed_[ComponentTraits<T>::TYPE_INDEX].set(entity_id);
+  }
+
+  template <typename T> bool changed(EcsId entity_id) const {
+    return changed_[ComponentTraits<T>::TYPE_INDEX].test(entity_id);
+  }
+
+  template <typename T> const System::ArenaBitSet& changes() const {
+    return changed_[ComponentTraits<T>::TYPE_INDEX];
+  }
+
+  // Marks physics changed for every entity with a non zero velocity, positions are integrated elsewhere.
+  void mark_moving_changed();
+  void clear_changes();
+
+  // Writes every entity, component array and counter, call after compact() so nothing is pending.
+  // Returns the bytes written, 0 when out is too small.
+  size_t snapshot_size() const;
+  size_t max_snapshot_size() const;
+  size_t write_snapshot(uint8_t* out, size_t capacity) const;
+
+  // Replaces the whole list with a snapshot, returns the bytes read or 0 when the snapshot does not fit.
+  // A snapshot that fails validation leaves the list untouched, one whose components do not point back
+  // at their entities is caught after loading and leaves the list empty.
+  size_t read_snapshot(const uint8_t* bytes, size_t size);
+
+  // Checks the header, the entity records and the free list of a snapshot without loading it, returns
+  // its size or 0. header is filled in when it is valid.
+  size_t validate_snapshot(const uint8_t* bytes, size_t size, EcsSnapshotHeader* header) const;
+
+  // Copies the record of entity_id out of a snapshot validate_snapshot() accepted with header, false when
+  // the id is outside it.
+  static bool snapshot_entity(const uint8_t* bytes, const EcsSnapshotHeader& header, EcsId entity_id, Entity* entity);
+
+  // Destroys everything at once, ids and generations start over.
+  void reset();
+
+  EntityHandle handle(EcsId entity_id) const {
+    ASSERT(entity_id >= 0 && entity_id < entities_used);
+    return EntityHandle{entity_id, entity_generations_[entity_id]};
+  }
+
+  bool is_valid(EntityHandle handle) const {
+    return handle.index >= 0 && handle.index < entities_used
+      && entity_generations_[handle.index] == handle.generation
+      && !entities[handle.index].defunct;
+  }
+
+  // nullptr when the entity was destroyed, even if its slot has been reused since.
+  Entity* resolve(EntityHandle handle) const {
+    return is_valid(handle) ? &entities[handle.index] : nullptr;
+  }
+
+  // Packs the live entities that have every component in Ts into rows of component indices, allocated from
+  // arena (the calling thread's scratch arena by default). The first type drives the walk, put the rarest first.
+  template <typename... Ts> EntityView<Ts...> view(System::MemoryArena* arena = System::memory_scratch_arena()) const;
+
+  // Dense storage of one registered component type, components<T>().used entries are live.
+  template <typename T> ComponentStorage<T>& components() {
+    return std::get<ComponentTraits<T>::TYPE_INDEX>(components_);
+  }
+
+  template <typename T> const ComponentStorage<T>& components() const {
+    return std::get<ComponentTraits<T>::TYPE_INDEX>(components_);
+  }
 
 public:
   Entity* entities = nullptr;
   int32_t entities_used = 0;
 
-  LifetimeComponent* lifetime_components = nullptr;
-  int32_t lifetime_componens_used = 0;
+private:
+  template <typename T> void add_component(Entity* entity);
+  template <typename T> void remove_component(Entity* entity);
+
+  ComponentRegistry::Storage components_ = {};
+  int32_t max_entities_ = 0;
+  System::MemoryArena* entity_arena = nullptr;
 
-  PhysicsComponent* physics_components = nullptr;
-  int32_t physics_components_used = 0;
-  
-  RenderComponent* render_components = nullptr;
-  int32_t render_components_used = 0;
+  // Entity records are pool slots so destroyed entities can hand their id back, entities points at the slots.
+  System::Pool<Entity> entity_pool_;
+  System::ArenaArray<EcsId> destroyed_entities_;
+  uint32_t* entity_generations_ = nullptr;
+  System::ArenaBitSet changed_[COMPONENT_TYPE_COUNT];
+};
 
-  SoundComponent* sound_components = nullptr;
-  int32_t sound_components_used = 0;
+template <typename... Ts> struct EntityViewRow {
+  EcsId entity_id;
+  EcsId component_idx[sizeof...(Ts)];
+
+  template <typename T> EcsId index() const {
+    return component_idx[component_type_index<T, Ts...>()];
+  }
+};
+
+// Rows are packed, iterating a view touches no Entity records. Views live as long as the arena they were
+// built in, scratch views are gone at the next frame.
+template <typename... Ts> class EntityView final {
+public:
+  using Row = EntityViewRow<Ts...>;
+  static constexpr ComponentSignature SIGNATURE = component_signature<Ts...>();
+
+  EntityView() = default;
+  EntityView(const Row* rows, int32_t count) : rows_(rows), count_(count) {}
+
+  const Row* begin() const { return rows_; }
+  const Row* end() const { return rows_ + count_; }
+  const Row& operator[](int32_t index) const {
+    ASSERT(index >= 0 && index < count_);
+    return rows_[index];
+  }
+
+  int32_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  // Splits the view into chunk_size sized sub views for handing to workers, the last chunk may be shorter.
+  int32_t chunk_count(int32_t chunk_size) const {
+    ASSERT(chunk_size > 0);
+    return (count_ + chunk_size - 1) / chunk_size;
+  }
+
+  EntityView chunk(int32_t chunk_index, int32_t chunk_size) const {
+    const int32_t first = chunk_index * chunk_size;
+    ASSERT(first >= 0 && first < count_);
+    return EntityView(rows_ + first, System::min(chunk_size, count_ - first));
+  }
+
+  class ChunkIterator {
+  public:
+    ChunkIterator(const EntityView* view, int32_t chunk_index, int32_t chunk_size)
+      : view_(view), chunk_index_(chunk_index), chunk_size_(chunk_size) {}
+
+    EntityView operator*() const { return view_->chunk(chunk_index_, chunk_size_); }
+    ChunkIterator& operator++() { chunk_index_++; return *this; }
+    bool operator!=(const ChunkIterator& other) const { return chunk_index_ != other.chunk_index_; }
+
+  private:
+    const EntityView* view_;
+    int32_t chunk_index_;
+    int32_t chunk_size_;
+  };
+
+  struct ChunkRange {
+    const EntityView* view;
+    int32_t chunk_size;
+
+    ChunkIterator begin() const { return ChunkIterator(view, 0, chunk_size); }
+    ChunkIterator end() const { return ChunkIterator(view, view->chunk_count(chunk_size), chunk_size); }
+  };
+
+  // for (EntityView chunk : view.chunks(1024)) { ... }
+  ChunkRange chunks(int32_t chunk_size) const { return ChunkRange{this, chunk_size}; }
 
 private:
-  int32_t max_entities_ = 0;
-  System::MemoryArena* entity_arena = nullptr;
+  const Row* rows_ = nullptr;
+  int32_t count_ = 0;
 };
 
+template <typename... Ts> EntityView<Ts...> EntityComponentList::view(System::MemoryArena* arena) const {
+  static_assert(sizeof...(Ts) > 0, "A view needs at least one component type");
+  using Driver = std::tuple_element_t<0, std::tuple<Ts...>>;
+  using Row = EntityViewRow<Ts...>;
+
+  const ComponentStorage<Driver>& driver = components<Driver>();
+  const int32_t driver_count = driver.used;
+  if (driver_count == 0) {
+    return EntityView<Ts...>();
+  }
+
+  Row* rows = System::arena_push<Row>(arena, driver_count);
+  ASSERT(rows);
+  if (!rows) {
+    return EntityView<Ts...>();
+  }
+
+  int32_t count = 0;
+  for (int32_t i = 0; i < driver_count; i++) {
+    const EcsId entity_id = driver.entity_of(i);
+    const Entity& entity = entities[entity_id];
+
+    // Written unconditionally and kept only when the signature matches, the walk does not branch per type.
+    rows[count] = Row{entity_id, {entity.index<Ts>()...}};
+    count += int32_t(!entity.defunct & entity.signature.contains(EntityView<Ts...>::SIGNATURE));
+  }
+
+  return EntityView<Ts...>(rows, count);
+}
+
 } //namespace
 } //namespace
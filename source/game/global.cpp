@@ -1,51 +1,99 @@
 // global.cpp
 #include "global.h"
 
-#include "system/random.h"
+#include "system/alloc_verifier.h"
 #include "math/transform.h"
 
 namespace Asteroids {
 namespace Game {
 
-const size_t Global::FILE_IO_ARENA_SIZE = System::MB(10);
-const size_t Global::MESH_ARENA_SIZE = System::MB(10);
-const size_t Global::RENDERER_ARENA_SIZE = System::MB(10);
-const size_t Global::ENTITY_ARENA_SIZE = System::MB(10);
-const size_t Global::QUADTREE_ARENA_SIZE = System::MB(16);
+// Arenas only commit what they use, these are address space budgets rather than memory budgets.
+const size_t Global::FILE_IO_ARENA_SIZE = System::MB(256);
+const size_t Global::MESH_ARENA_SIZE = System::MB(256);
+const size_t Global::RENDERER_ARENA_SIZE = System::MB(256);
+const size_t Global::ENTITY_ARENA_SIZE = System::GB(4);
+const size_t Global::QUADTREE_ARENA_SIZE = System::GB(4);
+const int32_t Global::QUADTREE_ARENA_BUFFER_COUNT = 2;
 
 const size_t Global::MAX_MESH_COUNT = 10;
 const size_t Global::MAX_VERTEX_ARRAY_COUNT = 10;
 const size_t Global::MAX_TEXTURE_COUNT = 10;
 const size_t Global::MAX_ENTITY_COUNT = 10000;
+const size_t Global::ASTEROID_COUNT = 5000;
+const int64_t Global::PROJECTILE_LIFETIME_MS = 3000;
+const int32_t Global::ENTITY_COMMANDS_PER_THREAD = 1024;
+const int32_t Global::SPATIAL_SORT_INTERVAL = 120;
+const int32_t Global::PROFILER_WINDOW = 256;
+const int32_t Global::PROFILER_DUMP_INTERVAL = 300;
 
 const float Global::WORLD_HALF_EDGE = 100000.0F;
 
+// The config is read through file_io_arena, the other arenas wait for init() and the page mode.
 Global::Global() {
   file_io_arena = System::memory_arena_create("FILEIO", FILE_IO_ARENA_SIZE);
-  mesh_arena = System::memory_arena_create("MESH", MESH_ARENA_SIZE);
-  renderer_arena = System::memory_arena_create("RENDER", RENDERER_ARENA_SIZE);
-  entity_arena = System::memory_arena_create("ENTITY", ENTITY_ARENA_SIZE);
-  quadtree_arena = System::memory_arena_create("QUADTREE", QUADTREE_ARENA_SIZE);
 }
 
 Global::~Global() {
-  System::memory_arena_free(file_io_arena);
-  System::memory_arena_free(mesh_arena);
-  System::memory_arena_free(renderer_arena);
-  System::memory_arena_free(entity_arena);
+  System::MemoryArena* arenas[] = {file_io_arena, mesh_arena, renderer_arena, entity_arena};
+  for (System::MemoryArena* arena : arenas) {
+    if (arena) {
+      System::memory_arena_free(arena);
+    }
+  }
+  System::frame_arena_free(&quadtree_arena);
 }
 
 void Global::finalize() {
+  if (snapshot_save_path[0] != '\0' && entity_list.entities) {
+    save_snapshot_file(snapshot_save_path);
+  }
+
   renderer.finalize();
   mesh_builder.finalize();
   sound_player.finalize();
   entity_list.finalize();
+  lifetime_system.finalize();
+  entity_commands.finalize();
+
+  if (profiler.system_count() > 0) {
+    profiler.dump(System::memory_scratch_arena());
+  }
+
+  System::memory_arena_dump_stats();
 }
 
 bool Global::init(const System::ConfigMap* config) {
   ASSERT(config);
   input.init(config);
 
+  // Arenas only commit what they use, so everything allocated from here on follows the page mode. The game
+  // arenas are created after it so even their headers do.
+  const int huge_pages = config->value_int("memory_huge_pages", 0);
+  System::memory_set_page_mode((System::MemoryPageMode)System::min(System::max(huge_pages, 0), 2));
+  System::memory_set_trace(config->value_int("memory_trace", 0) > 0);
+  System::memory_set_scratch_arena_size(System::KB(System::max(config->value_int("scratch_arena_kb", 4096), 64)));
+
+  mesh_arena = System::memory_arena_create("MESH", MESH_ARENA_SIZE);
+  renderer_arena = System::memory_arena_create("RENDER", RENDERER_ARENA_SIZE);
+  entity_arena = System::memory_arena_create("ENTITY", ENTITY_ARENA_SIZE);
+  if (!mesh_arena || !renderer_arena || !entity_arena
+    || !System::frame_arena_create(&quadtree_arena, "QUADTREE", QUADTREE_ARENA_SIZE, QUADTREE_ARENA_BUFFER_COUNT)) {
+    return false;
+  }
+
+  System::alloc_verifier_init(
+    config->value_int("verify_frame_allocs_warmup", 120),
+    config->value_int("verify_frame_allocs_abort", 0) > 0);
+
+  SDL_strlcpy(snapshot_save_path, config->value_str("snapshot_save", ""), sizeof(snapshot_save_path));
+
+  max_entity_count = System::max(config->value_int("max_entity_count", MAX_ENTITY_COUNT), 1);
+  asteroid_count = System::min(System::max(config->value_int("asteroid_count", ASTEROID_COUNT), 0), max_entity_count - 1);
+  spatial_sort_interval = System::max(config->value_int("spatial_sort_interval", SPATIAL_SORT_INTERVAL), 0);
+  profiler_dump_interval = System::max(config->value_int("profiler_dump_interval", PROFILER_DUMP_INTERVAL), 0);
+  quadtree_incremental = config->value_int("quadtree_incremental", 1) > 0;
+  quadtree_linear = config->value_int("quadtree_linear", 0) > 0;
+
   if (!renderer.init(renderer_arena)) {
     return false;
   }
@@ -75,43 +123,67 @@ bool Global::init(const System::ConfigMap* config) {
     return false;
   }
 
-  //FIXME: Load shaders and assets from 'resource pack'.
-  auto main_vert_shader_buffer = asset_file_io.read_bytes("E://Asteroids//shaders//test.vert", System::KB(10));
-  if (!is_valid(&main_vert_shader_buffer)) {
-    return false;
+  {
+    // Shader sources are only needed until the program is linked.
+    System::ArenaScope shader_scope(file_io_arena);
+
+    //FIXME: Load shaders and assets from 'resource pack'.
+    auto main_vert_shader_buffer = asset_file_io.read_bytes("E://Asteroids//shaders//test.vert", System::KB(10));
+    if (!is_valid(&main_vert_shader_buffer)) {
+      return false;
+    }
+
+    auto main_frag_shader_buffer = asset_file_io.read_bytes("E://Asteroids//shaders//test.frag", System::KB(10));
+    if (!is_valid(&main_frag_shader_buffer)) {
+      return false;
+    }
+
+    main_shader_handle = renderer.build_shader_program(&main_vert_shader_buffer, &main_frag_shader_buffer);
+    if (main_shader_handle == 0) {
+      return false;
+    }
   }
 
-  auto main_frag_shader_buffer = asset_file_io.read_bytes("E://Asteroids//shaders//test.frag", System::KB(10));
-  if (!is_valid(&main_frag_shader_buffer)) {
+  if (!mesh_builder.init(mesh_arena, MAX_MESH_COUNT)) {
+    return false;
+  }
+  
+  if (!entity_list.init(entity_arena, max_entity_count)) {
     return false;
   }
 
-  main_shader_handle = renderer.build_shader_program(&main_vert_shader_buffer, &main_frag_shader_buffer);
-  if (main_shader_handle == 0) {
+  if (!lifetime_system.init(entity_arena, max_entity_count)) {
     return false;
   }
 
-  if (!mesh_builder.init(mesh_arena, MAX_MESH_COUNT)) {
+  if (!entity_commands.init(entity_arena, ENTITY_COMMANDS_PER_THREAD)) {
     return false;
   }
-  
-  if (!entity_list.init(entity_arena, MAX_ENTITY_COUNT)) {
+
+  if (!profiler.init(entity_arena, System::max(config->value_int("profiler_window", PROFILER_WINDOW), 1))) {
     return false;
   }
 
   EntityData player = load_mesh_vertex_buffer("E://Asteroids-resources//ship-2.obj");
   player.sound_indecies[0] = sound_player.load_wav("E://Asteroids-resources//ship-propultion.wav");
-  player_entity_id = create_player_entity(&player);
 
   EntityData asteroid = load_mesh_vertex_buffer("E://Asteroids-resources//asteroid-mesh.obj");
   asteroid.sound_indecies[0] = sound_player.load_wav("E://Asteroids-resources//asteroid-explosion.wav");
-  for (int i = 0; i < 5000; i++) {
-    create_asteroid_entity(&asteroid, WORLD_HALF_EDGE);
-  }
 
   projectile_data = load_mesh_vertex_buffer("E://Asteroids-resources//projectile.obj");
 
+  // A snapshot replaces the random spawn, assets above still load in the same order so their indices match.
+  const char* snapshot_path = config->value_str("snapshot_load", "");
+  if (snapshot_path[0] == '\0' || !load_snapshot_file(snapshot_path)) {
+    player_entity_id = create_player_entity(&player);
+
+    const Prefab asteroid_prefab = make_prefab(&asteroid, PHYSICS_COMPONENT | RENDER_COMPONENT | SOUND_COMPONENT);
+    spawn_asteroids(&asteroid_prefab, asteroid_count, WORLD_HALF_EDGE);
+  }
+
+  System::memory_arena_log_usage(file_io_arena);
   System::memory_arena_free(file_io_arena);
+  file_io_arena = nullptr;
 
   if (sound_player.load_mp3("E://Asteroids-resources//music.mp3")) {
     sound_player.play_music();
@@ -120,11 +192,155 @@ bool Global::init(const System::ConfigMap* config) {
   return true;
 }
 
+size_t Global::max_snapshot_size() const {
+  return sizeof(GlobalSnapshotHeader) + entity_list.max_snapshot_size() + max_entity_count * sizeof(int64_t);
+}
+
+System::ByteBuffer Global::save_snapshot(System::MemoryArena* arena) {
+  ASSERT(arena);
+
+  const size_t entity_list_size = entity_list.snapshot_size();
+  const int32_t lifetime_count = entity_list.components<LifetimeComponent>().used;
+  const size_t size = sizeof(GlobalSnapshotHeader) + entity_list_size + lifetime_count * sizeof(int64_t);
+
+  System::ByteBuffer buffer = {};
+  buffer.bytes = System::arena_push<uint8_t>(arena, size);
+  if (!buffer.bytes) {
+    return buffer;
+  }
+
+  const GlobalSnapshotHeader header = {GLOBAL_SNAPSHOT_MAGIC, GLOBAL_SNAPSHOT_VERSION, player_entity_id, lifetime_count};
+  memcpy(buffer.bytes, &header, sizeof(header));
+
+  uint8_t* cursor = buffer.bytes + sizeof(header);
+  if (entity_list.write_snapshot(cursor, entity_list_size) != entity_list_size) {
+    buffer.bytes = nullptr;
+    return buffer;
+  }
+
+  // The blob makes no alignment promises, lifetimes are gathered separately and copied in.
+  System::ArenaScope scratch_scope(arena);
+  int64_t* remaining_ms = System::arena_push<int64_t>(arena, System::max(lifetime_count, 1));
+  if (!remaining_ms) {
+    buffer.bytes = nullptr;
+    return buffer;
+  }
+
+  lifetime_system.remaining(&entity_list, remaining_ms);
+  memcpy(cursor + entity_list_size, remaining_ms, lifetime_count * sizeof(int64_t));
+
+  buffer.size = size;
+  return buffer;
+}
+
+bool Global::load_snapshot(const System::ByteBuffer* buffer) {
+  ASSERT(buffer);
+
+  GlobalSnapshotHeader header = {};
+  if (!is_valid(buffer) || buffer->size < sizeof(header)) {
+    System::log_error("Snapshot is empty or truncated");
+    return false;
+  }
+
+  memcpy(&header, buffer->bytes, sizeof(header));
+  if (header.magic != GLOBAL_SNAPSHOT_MAGIC || header.version != GLOBAL_SNAPSHOT_VERSION) {
+    System::log_error("Snapshot version %u is not supported", header.version);
+    return false;
+  }
+
+  // Everything the headers and entity records say is checked before the list is touched, a rejected
+  // snapshot leaves init to build a new world. Only components that do not point back at their entities
+  // are caught while loading, read_snapshot() then leaves the list empty.
+  const uint8_t* cursor = buffer->bytes + sizeof(header);
+  EcsSnapshotHeader ecs_header = {};
+  const size_t entity_list_size = entity_list.validate_snapshot(cursor, buffer->size - sizeof(header), &ecs_header);
+  if (entity_list_size == 0) {
+    return false;
+  }
+
+  const int32_t lifetime_count = ecs_header.component_counts[ComponentTraits<LifetimeComponent>::TYPE_INDEX];
+  const size_t remaining_size = size_t(lifetime_count) * sizeof(int64_t);
+  if (header.lifetime_count != lifetime_count || sizeof(header) + entity_list_size + remaining_size > buffer->size) {
+    System::log_error("Snapshot lifetimes do not match its entities");
+    return false;
+  }
+
+  Entity player = {};
+  const ComponentSignature player_signature = PHYSICS_COMPONENT | RENDER_COMPONENT | SOUND_COMPONENT;
+  if (!EntityComponentList::snapshot_entity(cursor, ecs_header, header.player_entity_id, &player)
+    || player.defunct || !player.signature.contains(player_signature)) {
+    System::log_error("Snapshot player entity %d is not a live player", header.player_entity_id);
+    return false;
+  }
+
+  System::MemoryArena* scratch_arena = System::memory_scratch_arena();
+  System::ArenaScope scratch_scope(scratch_arena);
+
+  int64_t* remaining_ms = System::arena_push<int64_t>(scratch_arena, System::max(lifetime_count, 1));
+  if (!remaining_ms) {
+    return false;
+  }
+
+  if (entity_list.read_snapshot(cursor, entity_list_size) == 0) {
+    return false;
+  }
+
+  cursor += entity_list_size;
+  memcpy(remaining_ms, cursor, remaining_size);
+  lifetime_system.restore(&entity_list, remaining_ms);
+
+  player_entity_id = header.player_entity_id;
+  return true;
+}
+
+bool Global::load_snapshot_file(const char* path) {
+  ASSERT(file_io_arena);
+
+  System::FileIO io;
+  if (!io.init(file_io_arena)) {
+    return false;
+  }
+
+  System::ArenaScope file_scope(file_io_arena);
+
+  System::StopWatch timer;
+  const auto buffer = io.read_bytes(path, max_snapshot_size());
+  if (!load_snapshot(&buffer)) {
+    System::log_error("Failed to load snapshot [%s]", path);
+    return false;
+  }
+
+  System::log_info("Snapshot [%s] loaded, %zu bytes in %lf ms", path, buffer.size, timer.elapsed_ms());
+  return true;
+}
+
+bool Global::save_snapshot_file(const char* path) {
+  System::MemoryArena* arena = System::memory_arena_create("SNAPSHOT", max_snapshot_size() + System::MB(1));
+  if (!arena) {
+    return false;
+  }
+
+  System::FileIO io;
+  io.init(arena);
+
+  const auto buffer = save_snapshot(arena);
+  const bool saved = is_valid(&buffer) && io.write_bytes(path, &buffer) == buffer.size;
+  if (saved) {
+    System::log_info("Snapshot [%s] saved, %zu bytes", path, buffer.size);
+  } else {
+    System::log_error("Failed to save snapshot [%s]", path);
+  }
+
+  System::memory_arena_free(arena);
+  return saved;
+}
+
 EntityData Global::load_mesh_vertex_buffer(const char* obj_file_path) {
   EntityData out{
     .mesh = nullptr, 
     .vertex_array_idx = -1,
     .sound_indecies = {},
+    .half_edge = 0.0F,
   };
 
   System::FileIO io;
@@ -132,6 +348,9 @@ EntityData Global::load_mesh_vertex_buffer(const char* obj_file_path) {
     return out;
   }
 
+  // The obj text is parsed into the mesh arena, the file bytes are scratch.
+  System::ArenaScope file_scope(file_io_arena);
+
   auto mesh_buffer = io.read_bytes(obj_file_path, System::KB(100));
   if (!is_valid(&mesh_buffer)) {
     return out;
@@ -147,8 +366,14 @@ EntityData Global::load_mesh_vertex_buffer(const char* obj_file_path) {
     return out;
   }
 
+  Math::AABB bounds{Math::V3{0.0F, 0.0F, 0.0F}, 0.0F};
+  for (size_t i = 0; i < mesh->vertex_count; i++) {
+    bounds.update_edge(mesh->vertices[i].position);
+  }
+
   out.mesh = mesh;
   out.vertex_array_idx = va_idx;
+  out.half_edge = bounds.half_edge;
   
   return out;
 }
@@ -157,71 +382,67 @@ EcsId Global::create_player_entity(const EntityData* data) {
   ASSERT(entity_list.entities);
   Entity* player = entity_list.create_entity(PHYSICS_COMPONENT | SOUND_COMPONENT | RENDER_COMPONENT);
 
-  entity_list.render_components[player->render_component_idx].vertex_array_idx = data->vertex_array_idx;
-  entity_list.sound_components[player->sound_component_idx].sound_indecies[0] = data->sound_indecies[0];
-
-  entity_list.physics_components[player->physics_component_idx].orientation = 0.0F;
-  entity_list.physics_components[player->physics_component_idx].velocity = {0.0F, 0.5F, 0.0F};
-  entity_list.physics_components[player->physics_component_idx].aabb.pos = Math::V3{0.0F, 0.0F, 0.0F};
+  entity_list.components<RenderComponent>()[player->index<RenderComponent>()].vertex_array_idx = data->vertex_array_idx;
+  entity_list.components<SoundComponent>()[player->index<SoundComponent>()].sound_indecies[0] = data->sound_indecies[0];
 
-  const size_t mesh_vertex_count = data->mesh->vertex_count;
-  Math::AABB* aabb = &entity_list.physics_components[player->physics_component_idx].aabb;
+  PhysicsComponentArrays* physics_components = &entity_list.components<PhysicsComponent>();
+  PhysicsComponent physics = physics_components->get(player->index<PhysicsComponent>());
+  physics.orientation = 0.0F;
+  physics.velocity = {0.0F, 0.5F, 0.0F};
+  physics.aabb.pos = Math::V3{0.0F, 0.0F, 0.0F};
+  physics.aabb.half_edge = data->half_edge;
 
-  for (size_t i = 0; i < mesh_vertex_count; i++) {
-    aabb->update_edge(data->mesh->vertices[i].position);
-  }
+  physics_components->set(player->index<PhysicsComponent>(), physics);
 
   return player->entity_id;
 }
 
-EcsId Global::create_asteroid_entity(const EntityData* data, float world_half_edge) {
-  ASSERT(entity_list.entities);
-  static System::Random r;
-
-  Entity* asteroid = entity_list.create_entity(PHYSICS_COMPONENT | RENDER_COMPONENT | SOUND_COMPONENT);
-  entity_list.render_components[asteroid->render_component_idx].vertex_array_idx = data->vertex_array_idx;
-  entity_list.sound_components[asteroid->sound_component_idx].sound_indecies[0] = data->sound_indecies[0];
-
-  entity_list.physics_components[asteroid->physics_component_idx].orientation = 0.0F;
-  entity_list.physics_components[asteroid->physics_component_idx].velocity = {0.0F, 0.0F, 0.0F};
-  entity_list.physics_components[asteroid->physics_component_idx].aabb.pos = Math::V3{
-    r.random_float(-2, 2) * world_half_edge,
-    r.random_float(-2, 2) * world_half_edge,
-    0.0F
-  };
+Prefab Global::make_prefab(const EntityData* data, ComponentSignature components) {
+  ASSERT(data);
+
+  Prefab prefab = {};
+  prefab.components = components;
+  prefab.vertex_array_idx = data->vertex_array_idx;
+  memcpy(prefab.sound_indecies, data->sound_indecies, sizeof(prefab.sound_indecies));
+  prefab.half_edge = data->half_edge;
+  prefab.orientation = 0.0F;
+  prefab.velocity = Math::V3{0.0F, 0.0F, 0.0F};
+  prefab.mass = 0.0F;
+  return prefab;
+}
 
-  entity_list.sound_components[asteroid->sound_component_idx].sound_indecies[0] = data->sound_indecies[0];
+int32_t Global::spawn_asteroids(const Prefab* asteroid_prefab, int32_t count, float world_half_edge) {
+  ASSERT(entity_list.entities && asteroid_prefab);
 
-  const size_t mesh_vertex_count = data->mesh->vertex_count;
-  Math::AABB* aabb = &entity_list.physics_components[asteroid->physics_component_idx].aabb;
+  const SpawnBatch batch = entity_list.spawn_batch(asteroid_prefab, count,
+    [this, world_half_edge](PhysicsComponentArrays* physics, int32_t begin, int32_t end) {
+      for (int32_t i = begin; i < end; i++) {
+        physics->pos_x[i] = random.random_float(-2, 2) * world_half_edge;
+        physics->pos_y[i] = random.random_float(-2, 2) * world_half_edge;
+      }
+    });
 
-  for (size_t i = 0; i < mesh_vertex_count; i++) {
-    aabb->update_edge(data->mesh->vertices[i].position);
-  }
-
-  return asteroid->entity_id;
+  return batch.count;
 }
 
-EcsId Global::create_projectile_entity(const PhysicsComponent* player_physics) {
-  ASSERT(entity_list.entities);
-  
-  Entity* projectile = entity_list.create_entity(PHYSICS_COMPONENT | RENDER_COMPONENT);
-  entity_list.render_components[projectile->render_component_idx].vertex_array_idx = projectile_data.vertex_array_idx;
+EntityHandle Global::create_projectile_entity(EntityCommandBuffer* commands, const PhysicsComponent* player_physics) {
+  ASSERT(commands);
 
-  entity_list.physics_components[projectile->physics_component_idx].orientation = player_physics->orientation;
-  entity_list.physics_components[projectile->physics_component_idx].velocity =
-    Math::xyz(Math::rotate_z_axis(player_physics->orientation) * Math::xyzw(player_physics->velocity * 3.0F)); //FIXME:
+  const EntityHandle projectile = commands->create_entity(PHYSICS_COMPONENT | RENDER_COMPONENT);
+  commands->set_render(projectile, projectile_data.vertex_array_idx);
 
-  entity_list.physics_components[projectile->physics_component_idx].aabb.pos = player_physics->aabb.pos;
+  PhysicsComponent physics = {};
+  physics.orientation = player_physics->orientation;
+  physics.velocity =
+    Math::xyz(Math::rotate_z_axis(player_physics->orientation) * Math::xyzw(player_physics->velocity * 3.0F)); //FIXME:
 
-  const size_t mesh_vertex_count = projectile_data.mesh->vertex_count;
-  Math::AABB* aabb = &entity_list.physics_components[projectile->physics_component_idx].aabb;
+  physics.aabb.pos = player_physics->aabb.pos;
+  physics.aabb.half_edge = projectile_data.half_edge;
 
-  for (size_t i = 0; i < mesh_vertex_count; i++) {
-    aabb->update_edge(projectile_data.mesh->vertices[i].position);
-  }
+  commands->set_physics(projectile, physics);
+  commands->add_lifetime(projectile, PROJECTILE_LIFETIME_MS);
 
-  return projectile->entity_id;
+  return projectile;
 }
 
 } //namespace
@@ -4,9 +4,13 @@
 #include "system/system.h"
 #include "system/memory.h"
 #include "system/config.h"
+#include "system/random.h"
+#include "system/profiler.h"
 
 #include "game/input.h"
 #include "game/ecs.h"
+#include "game/lifetime.h"
+#include "game/command_buffer.h"
 
 #include "rendering/mesh.h"
 #include "rendering/renderer.h"
@@ -16,10 +20,22 @@
 namespace Asteroids {
 namespace Game {
 
+constexpr uint32_t GLOBAL_SNAPSHOT_MAGIC = 0x424c4741; // "AGLB"
+constexpr uint32_t GLOBAL_SNAPSHOT_VERSION = 1;
+
+// Followed by the entity list snapshot and the remaining lifetime of every lifetime component.
+struct GlobalSnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  EcsId player_entity_id;
+  int32_t lifetime_count;
+};
+
 struct EntityData {
   Rendering::TriangleMesh* mesh;
   int vertex_array_idx;
   int sound_indecies[MAX_SOUND_COMPONENT_SOUNDS];
+  float half_edge; // Bounds of the mesh, computed once when it is loaded
 };
 
 class Global final {
@@ -33,11 +49,18 @@ public:
   static const size_t RENDERER_ARENA_SIZE;
   static const size_t ENTITY_ARENA_SIZE;
   static const size_t QUADTREE_ARENA_SIZE;
+  static const int32_t QUADTREE_ARENA_BUFFER_COUNT;
 
   static const size_t MAX_MESH_COUNT;
   static const size_t MAX_VERTEX_ARRAY_COUNT;
   static const size_t MAX_TEXTURE_COUNT;
   static const size_t MAX_ENTITY_COUNT;
+  static const size_t ASTEROID_COUNT;
+  static const int64_t PROJECTILE_LIFETIME_MS;
+  static const int32_t ENTITY_COMMANDS_PER_THREAD;
+  static const int32_t SPATIAL_SORT_INTERVAL;
+  static const int32_t PROFILER_WINDOW;
+  static const int32_t PROFILER_DUMP_INTERVAL;
 
   static const float WORLD_HALF_EDGE;
 
@@ -45,13 +68,17 @@ public:
   System::MemoryArena* mesh_arena = nullptr;
   System::MemoryArena* renderer_arena = nullptr;
   System::MemoryArena* entity_arena = nullptr;
-  System::MemoryArena* quadtree_arena = nullptr;
+  System::FrameArena quadtree_arena = {};
 
   Game::InputHandler input;
   Rendering::Renderer renderer;
   Rendering::MeshBuilder mesh_builder;
   Audio::SoundPlayer sound_player;
   Game::EntityComponentList entity_list;
+  Game::LifetimeSystem lifetime_system;
+  Game::EntityCommandBuffer entity_commands;
+  System::Random random;
+  System::Profiler profiler;
 
   uint32_t main_shader_handle = 0;
   uint32_t player_ui_shader_handle = 0;
@@ -59,16 +86,35 @@ public:
 
   EcsId player_entity_id = ECSID_NOT_INITIALIZED;
 
+  int32_t max_entity_count = MAX_ENTITY_COUNT;
+  int32_t asteroid_count = ASTEROID_COUNT;
+  int32_t spatial_sort_interval = SPATIAL_SORT_INTERVAL; // Frames between component reorders, 0 disables it
+  int32_t profiler_dump_interval = PROFILER_DUMP_INTERVAL; // Frames between system timing dumps, 0 disables it
+  bool quadtree_incremental = true; // Keep the spatial tree across frames instead of rebuilding it every frame
+  bool quadtree_linear = false; // Sorted Morton key quadtree rebuilt every frame, takes precedence over the above
+
   bool init(const System::ConfigMap* config);
   void finalize();
 
   EntityData load_mesh_vertex_buffer(const char* obj_file_path);
+  static Prefab make_prefab(const EntityData* entity_data, ComponentSignature components);
 
   EntityData projectile_data;
 
+  // World state only, meshes and sounds are expected to be loaded in the same order as when saving.
+  size_t max_snapshot_size() const;
+  System::ByteBuffer save_snapshot(System::MemoryArena* arena);
+  bool load_snapshot(const System::ByteBuffer* buffer);
+  bool load_snapshot_file(const char* path);
+  bool save_snapshot_file(const char* path);
+
+  char snapshot_save_path[System::CONFIG_MAP_VAL_LEN] = {};
+
   EcsId create_player_entity(const EntityData* entity_data);
-  EcsId create_asteroid_entity(const EntityData* entity_data, float world_half_edge);
-  EcsId create_projectile_entity(const PhysicsComponent* player_physics);
+  // Spawns count asteroids at random positions within twice world_half_edge, returns how many were created.
+  int32_t spawn_asteroids(const Prefab* asteroid_prefab, int32_t count, float world_half_edge);
+  // Recorded into commands, the projectile exists once the buffer is played back.
+  EntityHandle create_projectile_entity(EntityCommandBuffer* commands, const PhysicsComponent* player_physics);
 };
 
 } //namespace
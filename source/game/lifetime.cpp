@@ -0,0 +1,83 @@
+// lifetime.cpp
+#include "lifetime.h"
+
+namespace Asteroids {
+namespace Game {
+
+bool LifetimeSystem::init(System::MemoryArena* arena, int32_t max_entity_count) {
+  ASSERT(arena && max_entity_count > 0);
+
+  if (!wheel_.init(arena, max_entity_count)) {
+    return false;
+  }
+
+  generations_ = System::arena_push<uint32_t>(arena, max_entity_count);
+  return generations_ != nullptr;
+}
+
+void LifetimeSystem::finalize() {
+  System::log_info("LIFETIME: %zu expired, %d pending", expired_count_, wheel_.pending_count());
+}
+
+bool LifetimeSystem::add(EntityComponentList* entity_list, EcsId entity_id, int64_t lifetime_ms) {
+  ASSERT(entity_list && lifetime_ms >= 0);
+
+  if (!entity_list->add_lifetime_component(entity_id, lifetime_ms)) {
+    return false;
+  }
+
+  schedule(entity_list, entity_id, lifetime_ms);
+  return true;
+}
+
+void LifetimeSystem::schedule(const EntityComponentList* entity_list, EcsId entity_id, int64_t lifetime_ms) {
+  generations_[entity_id] = entity_list->handle(entity_id).generation;
+
+  const uint64_t now_tick = wheel_.now();
+  wheel_.schedule(entity_id, now_tick + (uint64_t(System::max(lifetime_ms, int64_t(0))) + LIFETIME_TICK_MS - 1) / LIFETIME_TICK_MS);
+}
+
+void LifetimeSystem::remaining(const EntityComponentList* entity_list, int64_t* remaining_ms) const {
+  ASSERT(entity_list && remaining_ms);
+
+  const ComponentArray<LifetimeComponent>& lifetimes = entity_list->components<LifetimeComponent>();
+  for (int32_t i = 0; i < lifetimes.used; i++) {
+    const EcsId entity_id = lifetimes[i].entity_id;
+    remaining_ms[i] = wheel_.scheduled(entity_id)
+      ? int64_t((wheel_.expires(entity_id) - wheel_.now()) * LIFETIME_TICK_MS)
+      : 0;
+  }
+}
+
+void LifetimeSystem::restore(EntityComponentList* entity_list, const int64_t* remaining_ms) {
+  ASSERT(entity_list && remaining_ms);
+
+  wheel_.clear();
+  now_ms_ = 0.0;
+
+  const ComponentArray<LifetimeComponent>& lifetimes = entity_list->components<LifetimeComponent>();
+  for (int32_t i = 0; i < lifetimes.used; i++) {
+    schedule(entity_list, lifetimes[i].entity_id, remaining_ms[i]);
+  }
+}
+
+int32_t LifetimeSystem::update(EntityComponentList* entity_list, float delta_time_ms) {
+  ASSERT(entity_list);
+
+  now_ms_ += delta_time_ms;
+  int32_t expired = 0;
+
+  wheel_.advance(uint64_t(now_ms_) / LIFETIME_TICK_MS, [&](int32_t entity_id) {
+    const EntityHandle handle = {entity_id, generations_[entity_id]};
+    if (entity_list->is_valid(handle)) {
+      entity_list->destroy_entity(handle);
+      expired++;
+    }
+  });
+
+  expired_count_ += expired;
+  return expired;
+}
+
+} //namespace
+} //namespace
@@ -0,0 +1,47 @@
+// lifetime.h
+#pragma once
+
+#include "system/timing_wheel.h"
+
+#include "ecs.h"
+
+namespace Asteroids {
+namespace Game {
+
+constexpr uint64_t LIFETIME_TICK_MS = 4;
+
+// Expires entities with a LifetimeComponent. Each entity id owns one timer in a timing wheel, so a frame
+// only touches the entities that expire in it. Expired entities go through destroy_entity() and are
+// removed with everything else at the next compact().
+class LifetimeSystem final {
+  DISABLE_COPY_AND_MOVE(LifetimeSystem);
+public:
+  LifetimeSystem() = default;
+  ~LifetimeSystem() = default;
+
+  bool init(System::MemoryArena* arena, int32_t max_entity_count);
+  void finalize();
+
+  bool add(EntityComponentList* entity_list, EcsId entity_id, int64_t lifetime_ms);
+
+  // Returns the number of entities that expired.
+  int32_t update(EntityComponentList* entity_list, float delta_time_ms);
+
+  // Time left for each lifetime component in dense order, for snapshots. restore() reschedules every
+  // lifetime component of a freshly loaded list from such an array.
+  void remaining(const EntityComponentList* entity_list, int64_t* remaining_ms) const;
+  void restore(EntityComponentList* entity_list, const int64_t* remaining_ms);
+
+private:
+  void schedule(const EntityComponentList* entity_list, EcsId entity_id, int64_t lifetime_ms);
+
+  System::TimingWheel wheel_;
+
+  // Generation each timer was scheduled for, ids recycled since then are left alone.
+  uint32_t* generations_ = nullptr;
+  double now_ms_ = 0.0;
+  size_t expired_count_ = 0;
+};
+
+} //namespace
+} //namespace
@@ -0,0 +1,129 @@
+// linear_quadtree.cpp
+#include "linear_quadtree.h"
+
+#include <bit>
+
+#include "system/radix_sort.h"
+
+namespace Asteroids {
+namespace Game {
+
+// Sorts after every real key, LINEAR_QUADTREE_MAX_LEVEL keeps the largest one below it.
+constexpr uint32_t LINEAR_QUADTREE_OUTSIDE_KEY = UINT32_MAX;
+
+bool LinearQuadTree::init(System::MemoryArena* arena, int32_t max_depth, float max_half_edge, int32_t max_entities) {
+  ASSERT(arena && max_entities > 0 && max_half_edge > 0.0F);
+  ASSERT(max_depth >= 1 && max_depth - 1 <= LINEAR_QUADTREE_MAX_LEVEL);
+
+  entity_ids_ = System::arena_push<EcsId>(arena, max_entities);
+  nodes_ = System::arena_push<LinearQuadTreeNode>(arena, max_entities);
+  if (!entity_ids_ || !nodes_) {
+    return false;
+  }
+
+  max_entities_ = max_entities;
+  entity_count_ = 0;
+  node_count_ = 0;
+
+  max_level_ = max_depth - 1;
+  min_ = -max_half_edge;
+  max_ = max_half_edge;
+  cells_per_unit_ = float(1 << max_level_) / (2.0F * max_half_edge);
+  return true;
+}
+
+LinearQuadTree::Cell LinearQuadTree::cell_of(float min_x, float min_y, float max_x, float max_y) const {
+  const uint32_t last_cell = (uint32_t(1) << max_level_) - 1;
+  auto quantize = [this, last_cell](float value) {
+    const float clamped = value < min_ ? min_ : (value > max_ ? max_ : value);
+    return System::min(uint32_t((clamped - min_) * cells_per_unit_), last_cell);
+  };
+
+  const uint32_t x0 = quantize(min_x);
+  const uint32_t y0 = quantize(min_y);
+  const uint32_t x1 = quantize(max_x);
+  const uint32_t y1 = quantize(max_y);
+
+  // Corners sharing the top bits share the cell at that level, the first differing bit bounds the depth.
+  const int32_t shift = int32_t(std::bit_width((x0 ^ x1) | (y0 ^ y1)));
+  const uint32_t level_mask = ~((uint32_t(1) << (2 * shift)) - 1);
+  return Cell{Math::morton_encode(x0, y0) & level_mask, max_level_ - shift};
+}
+
+int32_t LinearQuadTree::lower_bound(uint32_t key) const {
+  int32_t first = 0;
+  int32_t count = node_count_;
+
+  while (count > 0) {
+    const int32_t half = count / 2;
+    if (nodes_[first + half].key < key) {
+      first += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+
+  return first;
+}
+
+bool LinearQuadTree::build(const PhysicsComponentArrays& physics, System::MemoryArena* scratch_arena) {
+  ASSERT(entity_ids_ && scratch_arena);
+
+  entity_count_ = 0;
+  node_count_ = 0;
+
+  const int32_t count = physics.used;
+  if (count > max_entities_) {
+    System::log_error("LinearQuadTree: %d entities do not fit in %d", count, max_entities_);
+    return false;
+  }
+
+  if (count == 0) {
+    return true;
+  }
+
+  System::ArenaScope scratch_scope(scratch_arena);
+  uint32_t* keys = System::arena_push<uint32_t>(scratch_arena, count);
+  int32_t* order = System::arena_push<int32_t>(scratch_arena, count);
+  if (!keys || !order) {
+    return false;
+  }
+
+  // Every key depends on one entity only, the pass splits across threads as it is.
+  for (int32_t i = 0; i < count; i++) {
+    const float half_edge = physics.half_edge[i];
+    const float min_x = physics.pos_x[i] - half_edge;
+    const float min_y = physics.pos_y[i] - half_edge;
+    const float max_x = physics.pos_x[i] + half_edge;
+    const float max_y = physics.pos_y[i] + half_edge;
+
+    const bool outside = min_x < min_ || min_y < min_ || max_x > max_ || max_y > max_;
+    const Cell cell = cell_of(min_x, min_y, max_x, max_y);
+    keys[i] = outside ? LINEAR_QUADTREE_OUTSIDE_KEY : node_key(cell.code, cell.level);
+  }
+
+  if (!System::radix_sort_indices(keys, count, order, scratch_arena)) {
+    return false;
+  }
+
+  for (int32_t i = 0; i < count; i++) {
+    const uint32_t key = keys[order[i]];
+    if (key == LINEAR_QUADTREE_OUTSIDE_KEY) {
+      break;
+    }
+
+    if (node_count_ == 0 || nodes_[node_count_ - 1].key != key) {
+      nodes_[node_count_++] = LinearQuadTreeNode{key, i, 0};
+    }
+
+    nodes_[node_count_ - 1].count++;
+    entity_ids_[i] = physics.entity_id[order[i]];
+    entity_count_++;
+  }
+
+  return true;
+}
+
+} //namespace
+} //namespace
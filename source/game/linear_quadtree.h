@@ -0,0 +1,114 @@
+// linear_quadtree.h
+#pragma once
+
+#include "system/memory.h"
+
+#include "math/aabb.h"
+#include "math/morton.h"
+
+#include "ecs.h"
+
+namespace Asteroids {
+namespace Game {
+
+// Levels below the root, 2 * LINEAR_QUADTREE_MAX_LEVEL code bits and the level share a 32 bit key.
+constexpr int32_t LINEAR_QUADTREE_LEVEL_BITS = 4;
+constexpr int32_t LINEAR_QUADTREE_MAX_LEVEL = 14;
+
+// A non empty node, its entities are entity_ids()[first, first + count). key is the Morton code of the
+// node's first finest level cell shifted above the node's level, so sorting by key puts every node right
+// before its subtree.
+struct LinearQuadTreeNode {
+  uint32_t key;
+  int32_t first;
+  int32_t count;
+};
+
+// Pointerless quadtree rebuilt from the physics components. Every entity gets the key of the deepest cell
+// that holds its AABB, the same node QuadTree::insert would pick on the grid, and the keys are radix
+// sorted. Nodes are the runs of equal keys and a subtree is one contiguous run of nodes, so build() is a
+// key pass, a sort and a linear scan, and queries are binary searches over one array. Everything is an
+// index, the arrays can be copied or snapshotted as they are. Entities outside the root are left out.
+class LinearQuadTree final {
+  DISABLE_COPY_AND_MOVE(LinearQuadTree);
+public:
+  LinearQuadTree() = default;
+  ~LinearQuadTree() = default;
+
+  // max_depth counts the root like QuadTree, so a depth of 10 has levels 0 to 9.
+  bool init(System::MemoryArena* arena, int32_t max_depth, float max_half_edge, int32_t max_entities);
+
+  // Temporaries come from scratch_arena. Ids stay valid until the components are compacted or sorted.
+  bool build(const PhysicsComponentArrays& physics, System::MemoryArena* scratch_arena);
+
+  // Calls f(EcsId) for every entity whose node contains or lies inside the deepest cell holding aabb,
+  // every candidate that can overlap it. Returns the number of entities visited.
+  template <typename F> int32_t query(const Math::AABB& aabb, F&& f) const;
+
+  const EcsId* entity_ids() const { return entity_ids_; }
+  const LinearQuadTreeNode* nodes() const { return nodes_; }
+  int32_t entity_count() const { return entity_count_; }
+  int32_t node_count() const { return node_count_; }
+
+private:
+  struct Cell {
+    uint32_t code; // Finest level Morton code of the cell's first finest cell
+    int32_t level;
+  };
+
+  // Clamps aabb to the root, used by queries so a box on the edge still finds its neighbours.
+  Cell cell_of(float min_x, float min_y, float max_x, float max_y) const;
+
+  static uint32_t node_key(uint32_t code, int32_t level) {
+    return (code << LINEAR_QUADTREE_LEVEL_BITS) | uint32_t(level);
+  }
+
+  // First node whose key is not less than key.
+  int32_t lower_bound(uint32_t key) const;
+
+  EcsId* entity_ids_ = nullptr;
+  LinearQuadTreeNode* nodes_ = nullptr;
+  int32_t entity_count_ = 0;
+  int32_t node_count_ = 0;
+  int32_t max_entities_ = 0;
+
+  int32_t max_level_ = 0;
+  float min_ = 0.0F;
+  float max_ = 0.0F;
+  float cells_per_unit_ = 0.0F;
+};
+
+template <typename F> int32_t LinearQuadTree::query(const Math::AABB& aabb, F&& f) const {
+  const Cell cell = cell_of(aabb.pos.x - aabb.half_edge, aabb.pos.y - aabb.half_edge,
+    aabb.pos.x + aabb.half_edge, aabb.pos.y + aabb.half_edge);
+
+  int32_t visited = 0;
+  auto visit = [this, &f, &visited](int32_t first_node, int32_t end_node) {
+    if (first_node < end_node) {
+      const int32_t end = nodes_[end_node - 1].first + nodes_[end_node - 1].count;
+      for (int32_t i = nodes_[first_node].first; i < end; i++) {
+        f(entity_ids_[i]);
+      }
+      visited += end - nodes_[first_node].first;
+    }
+  };
+
+  // Ancestors hold entities too big for the cell, each one is a single node if it exists.
+  for (int32_t level = 0; level < cell.level; level++) {
+    const uint32_t ancestor_code = cell.code & ~((uint32_t(1) << (2 * (max_level_ - level))) - 1);
+    const uint32_t key = node_key(ancestor_code, level);
+    const int32_t node = lower_bound(key);
+    if (node < node_count_ && nodes_[node].key == key) {
+      visit(node, node + 1);
+    }
+  }
+
+  // The cell and everything below it is one run of nodes.
+  const uint32_t end_code = cell.code + (uint32_t(1) << (2 * (max_level_ - cell.level)));
+  const int32_t end_node = (end_code >> (2 * max_level_)) ? node_count_ : lower_bound(node_key(end_code, 0));
+  visit(lower_bound(node_key(cell.code, cell.level)), end_node);
+  return visited;
+}
+
+} //namespace
+} //namespace
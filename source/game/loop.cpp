@@ -2,6 +2,7 @@
 #include "loop.h"
 
 #include "math/transform.h"
+#include "system/alloc_verifier.h"
 
 #include "debug.h"
 
@@ -11,6 +12,18 @@ namespace Game {
 constexpr float MIN_VIEW_RECT_HALF_WIDTH = 1000.0F;
 constexpr float MAX_VIEW_RECT_HALF_WIDTH = 100000.0F;
 
+static const char* LOOP_SYSTEM_NAMES[LOOP_SYSTEM_COUNT] = {
+  "player",
+  "integration",
+  "spatial index",
+  "collision",
+  "commands",
+  "lifetime",
+  "compact",
+  "spatial sort",
+  "render",
+};
+
 bool Loop::init(Global* global) {
   ASSERT(global);
   global_ = global;
@@ -19,10 +32,29 @@ bool Loop::init(Global* global) {
   view_rect_half_width_ = MIN_VIEW_RECT_HALF_WIDTH;
   camera_position_ = Math::V3(0, 0, 10);
 
-  entity_tree_.init(global_->quadtree_arena, 10, Global::WORLD_HALF_EDGE);
+  // The incremental and linear trees claim one buffer of the quadtree arena for good, rebuilding flips between them.
+  if (global_->quadtree_linear) {
+    if (!linear_tree_.init(System::frame_arena_next(&global_->quadtree_arena), QUADTREE_MAX_DEPTH,
+      Global::WORLD_HALF_EDGE, global_->max_entity_count)) {
+      System::log_error("Loop: failed to create the linear quadtree");
+      return false;
+    }
+  } else if (global_->quadtree_incremental) {
+    if (!entity_tree_.init_incremental(System::frame_arena_next(&global_->quadtree_arena), QUADTREE_MAX_DEPTH,
+      Global::WORLD_HALF_EDGE, global_->max_entity_count)) {
+      System::log_error("Loop: failed to create the incremental quadtree");
+      return false;
+    }
+  } else {
+    entity_tree_.init(System::frame_arena_next(&global_->quadtree_arena), QUADTREE_MAX_DEPTH, Global::WORLD_HALF_EDGE);
+  }
 
   init_asteroids();
 
+  for (int32_t i = 0; i < LOOP_SYSTEM_COUNT; i++) {
+    profiler_ids_[i] = global_->profiler.register_system(LOOP_SYSTEM_NAMES[i]);
+  }
+
   running_ = true;
   return running_;
 }
@@ -35,7 +67,7 @@ void Loop::init_asteroids() {
 
   //System::StopWatch timer;
   //while (physics_component < physics_component_end) {
-  //  entity_tree_.insert(physics_component->entity_id, physics_component->aabb);
+  //  entity_tree_.insert(global_->entity_list.handle(physics_component->entity_id), physics_component->aabb);
   //  physics_component++;
   //}
   //System::log_info("QT: %lf", timer.elapsed_ms());
@@ -49,11 +81,16 @@ void Loop::run() {
 
   uint64_t previous_frame_time = 0;
   uint64_t delta_time = 0;
-  System::StopWatch timer;
 
   while (running_) {
-    SDL_PumpEvents();
-    global_->input.update();
+    System::memory_scratch_begin_frame();
+    System::alloc_verifier_begin_frame();
+
+    {
+      ALLOC_VERIFIER_SCOPE("INPUT");
+      SDL_PumpEvents();
+      global_->input.update();
+    }
 
     //FIXME: Switch to menu loop instead.
     if (global_->input.quit_pressed()) {
@@ -72,32 +109,160 @@ void Loop::run() {
     delta_time = SDL_GetTicks() - previous_frame_time;
     previous_frame_time = SDL_GetTicks();
 
-    timer.reset();
-    update(delta_time);
-    System::log_info("UPDATE: %lf", timer.elapsed_ms());
-    timer.reset();
-    render();
-    System::log_info("RENDER: %lf", timer.elapsed_ms());
+    {
+      ALLOC_VERIFIER_SCOPE("UPDATE");
+      update(delta_time);
+    }
+
+    {
+      ALLOC_VERIFIER_SCOPE("RENDER");
+      render();
+    }
+
+    if (global_->profiler_dump_interval > 0 && ++frames_since_profiler_dump_ >= global_->profiler_dump_interval) {
+      global_->profiler.dump(System::memory_scratch_arena());
+      frames_since_profiler_dump_ = 0;
+    }
+
+    System::alloc_verifier_end_frame();
   }
 }
 
 void Loop::update(float delta_time) {
-  
-  const auto player_position = update_player_entity(&global_->entity_list.entities[0], delta_time);
+  auto entity_list = &global_->entity_list;
+  auto profiler = &global_->profiler;
+
+  Math::V3 player_position;
+  {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_PLAYER]);
+    player_position = update_player_entity(&entity_list->entities[global_->player_entity_id], delta_time);
+    scope.set_entity_count(1);
+  }
 
-  Entity* none_player_entity = &global_->entity_list.entities[1];
-  Entity* entities_end = global_->entity_list.entities + global_->entity_list.entities_used;
-  
-  entity_tree_.finalize();
-  entity_tree_.init(global_->quadtree_arena, 10, Global::WORLD_HALF_EDGE);
+  // Physics components are dense, walking them visits live entities only. The player was moved above,
+  // integrating the ranges around it keeps the loops branch free so they vectorize.
+  const auto physics = &entity_list->components<PhysicsComponent>();
+  const int32_t physics_used = physics->used;
+  const int32_t player_physics_idx = entity_list->entities[global_->player_entity_id].index<PhysicsComponent>();
+
+  {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_INTEGRATION]);
+    integrate_positions(physics, 0, player_physics_idx, delta_time);
+    integrate_positions(physics, player_physics_idx + 1, physics_used, delta_time);
+    entity_list->mark_moving_changed();
+    scope.set_entity_count(physics_used);
+  }
+
+  {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_SPATIAL_INDEX]);
+
+    if (global_->quadtree_linear || entity_tree_.incremental()) {
+      // Static entities keep their node and transform, only what moved or was created is visited.
+      int32_t updated = 0;
+      entity_list->changes<PhysicsComponent>().for_each([this, entity_list, &updated](EcsId entity_id) {
+        const Entity* entity = &entity_list->entities[entity_id];
+        if (entity_id != global_->player_entity_id && !entity->defunct
+          && entity->has<PhysicsComponent>() && entity->has<RenderComponent>()) {
+          update_entity(entity_id, entity->index<PhysicsComponent>(), entity->index<RenderComponent>());
+          updated++;
+        }
+      });
+
+      if (global_->quadtree_linear) {
+        // Rebuilt from every physics component, a key pass, a radix sort and a scan.
+        linear_tree_.build(*physics, System::memory_scratch_arena());
+        updated = physics_used;
+      } else {
+        entity_tree_.merge_empty_nodes();
+      }
+
+      scope.set_entity_count(updated);
+    } else {
+      // Last frame's tree stays intact in the other buffer, the new one is built without clearing memory.
+      entity_tree_.finalize();
+      entity_tree_.init(System::frame_arena_next(&global_->quadtree_arena), QUADTREE_MAX_DEPTH, Global::WORLD_HALF_EDGE);
+
+      const PhysicsRenderView view = entity_list->view<PhysicsComponent, RenderComponent>();
+      for (const auto& row : view) {
+        if (row.entity_id != global_->player_entity_id) {
+          update_entity(row.entity_id, row.index<PhysicsComponent>(), row.index<RenderComponent>());
+        }
+      }
+
+      scope.set_entity_count(view.size());
+    }
+  }
+
+  {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_COLLISION]);
+    const Math::AABB player_aabb = physics->aabb(player_physics_idx);
+
+    if (global_->quadtree_linear) {
+      //FIXME: Broad phase only, like find_colliding_entities().
+      const EcsId player_entity_id = global_->player_entity_id;
+      int32_t candidates = 0;
+      linear_tree_.query(player_aabb, [player_entity_id, &candidates](EcsId entity_id) {
+        candidates += entity_id != player_entity_id ? 1 : 0;
+      });
+      scope.set_entity_count(candidates);
+    } else {
+      scope.set_entity_count(find_colliding_entities(player_aabb));
+    }
+  }
 
-  for (; none_player_entity < entities_end; none_player_entity++) {
-    update_entity(none_player_entity, delta_time);
+  // Changes are consumed, whatever is recorded from here on is picked up next frame.
+  entity_list->clear_changes();
+
+  // Sync point, structural changes recorded during the update are applied before destruction is compacted.
+  {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_COMMANDS]);
+    scope.set_entity_count(global_->entity_commands.pending_count());
+    global_->entity_commands.playback(entity_list, &global_->lifetime_system);
+  }
+
+  {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_LIFETIME]);
+    scope.set_entity_count(entity_list->components<LifetimeComponent>().used);
+    global_->lifetime_system.update(entity_list, delta_time);
+  }
+
+  {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_COMPACT]);
+    scope.set_entity_count(entity_list->destroyed_count());
+
+    // Ids are reused once compacted, the incremental tree must not keep entries for them.
+    if (entity_tree_.incremental()) {
+      for (const EcsId entity_id : entity_list->destroyed_entities()) {
+        entity_tree_.remove(entity_id);
+      }
+    }
+
+    entity_list->compact();
+  }
+
+  // Keeps world neighbours close in the component arrays as things move, the tree holds handles so it is unaffected.
+  if (global_->spatial_sort_interval > 0 && ++frames_since_spatial_sort_ >= global_->spatial_sort_interval) {
+    System::ProfileScope scope(profiler, profiler_ids_[LOOP_SYSTEM_SPATIAL_SORT]);
+    scope.set_entity_count(entity_list->components<PhysicsComponent>().used);
+    entity_list->sort_spatially(System::memory_scratch_arena());
+    frames_since_spatial_sort_ = 0;
   }
 
   update_view_projection(player_position);
 }
 
+void Loop::integrate_positions(PhysicsComponentArrays* physics, int32_t begin, int32_t end, float delta_time) {
+  float* __restrict pos_x = physics->pos_x;
+  float* __restrict pos_y = physics->pos_y;
+  const float* __restrict vel_x = physics->vel_x;
+  const float* __restrict vel_y = physics->vel_y;
+
+  for (int32_t i = begin; i < end; i++) {
+    pos_x[i] += vel_x[i] * delta_time;
+    pos_y[i] += vel_y[i] * delta_time;
+  }
+}
+
 void Loop::update_view_projection(const Math::V3& player_position) {
   camera_position_.x = player_position.x;
   camera_position_.y = player_position.y;
@@ -110,15 +275,21 @@ void Loop::update_view_projection(const Math::V3& player_position) {
   //projection_matrix_ = Math::perspective(90, aspect_ratio_, 0.1F, -10000.0F);
 }
 
-void Loop::update_entity(const Entity* entity, float delta_time) {
-
-  auto physics_component = &global_->entity_list.physics_components[entity->physics_component_idx];
-  auto render_component = &global_->entity_list.render_components[entity->render_component_idx];
+void Loop::update_entity(EcsId entity_id, int32_t physics_idx, int32_t render_idx) {
+  const auto physics = &global_->entity_list.components<PhysicsComponent>();
+  auto render_component = &global_->entity_list.components<RenderComponent>()[render_idx];
 
-  physics_component->aabb.pos = physics_component->aabb.pos + (physics_component->velocity * delta_time);
-  render_component->world_transform = Math::translate(physics_component->aabb.pos);
+  // Most of the world is static, only moved or new entities need their transform rebuilt.
+  const auto entity_list = &global_->entity_list;
+  if (entity_list->changed<PhysicsComponent>(entity_id) || entity_list->changed<RenderComponent>(entity_id)) {
+    render_component->transform.x = physics->pos_x[physics_idx];
+    render_component->transform.y = physics->pos_y[physics_idx];
+  }
 
-  entity_tree_.insert(physics_component->entity_id, physics_component->aabb);
+  // The linear tree is rebuilt from the physics arrays as a whole.
+  if (!global_->quadtree_linear) {
+    entity_tree_.insert(global_->entity_list.handle(entity_id), physics->aabb(physics_idx));
+  }
 }
 
 Math::V3 Loop::update_player_entity(const Entity* player_entity, float delta_time) {
@@ -128,9 +299,11 @@ Math::V3 Loop::update_player_entity(const Entity* player_entity, float delta_tim
   auto input = &global_->input;
   bool player_moved = false;
 
-  auto player_physics = &global_->entity_list.physics_components[player_entity->physics_component_idx];
-  auto player_render = &global_->entity_list.render_components[player_entity->render_component_idx];
-  auto player_sound = &global_->entity_list.sound_components[player_entity->sound_component_idx];
+  PhysicsComponentArrays* physics_components = &global_->entity_list.components<PhysicsComponent>();
+  PhysicsComponent player_physics_value = physics_components->get(player_entity->index<PhysicsComponent>());
+  auto player_physics = &player_physics_value;
+  auto player_render = &global_->entity_list.components<RenderComponent>()[player_entity->index<RenderComponent>()];
+  auto player_sound = &global_->entity_list.components<SoundComponent>()[player_entity->index<SoundComponent>()];
 
   player_physics->aabb.half_edge = scale;
 
@@ -153,14 +326,14 @@ Math::V3 Loop::update_player_entity(const Entity* player_entity, float delta_tim
 
   if (input->shoot_pressed() && !input->shoot_was_pressed()) {
     //Entity* projectile = global_->entity_list.create_entity(PHYSICS_COMPONENT | RENDER_COMPONENT);
-    global_->create_projectile_entity(player_physics);
+    global_->create_projectile_entity(&global_->entity_commands, player_physics);
   }
 
-  const auto position = player_physics->aabb.pos;
-  player_render->world_transform = Math::scale(scale, scale, scale) * Math::rotate_z_axis(-player_physics->orientation) * Math::translate(position);
+  physics_components->set(player_entity->index<PhysicsComponent>(), *player_physics);
+  global_->entity_list.mark_changed<PhysicsComponent>(player_entity->entity_id);
 
-  QTNode* containing_node = entity_tree_.query(player_physics->aabb);
-  ASSERT(containing_node);
+  const auto position = player_physics->aabb.pos;
+  player_render->transform = Math::Transform2D{position.x, position.y, player_physics->orientation, scale};
 
   /*PhysicsComponent* asteroid_physics_component = &global_->entity_list.physics_components[1];
   PhysicsComponent* asteroid_physics_component_end = global_->entity_list.physics_components + global_->entity_list.physics_components_used;
@@ -176,14 +349,26 @@ Math::V3 Loop::update_player_entity(const Entity* player_entity, float delta_tim
   return position;
 }
 
-void Loop::find_colliding_entities(QTNode* node) {
-  
+int32_t Loop::find_colliding_entities(const Math::AABB& aabb) {
+  auto entity_list = &global_->entity_list;
+
+  //FIXME: Broad phase only, candidates are counted but not tested against the player yet.
+  int32_t candidates = 0;
+  entity_tree_.query_candidates(aabb, [entity_list, &candidates](EntityHandle entity) {
+    candidates += entity_list->resolve(entity) ? 1 : 0;
+  });
+
+  return candidates;
 }
 
 void Loop::render() {
+  System::ProfileScope scope(&global_->profiler, profiler_ids_[LOOP_SYSTEM_RENDER]);
+
   auto renderer = &global_->renderer;
-  RenderComponent* render_component = global_->entity_list.render_components;
-  RenderComponent* render_component_end = render_component + global_->entity_list.render_components_used;
+  const ComponentArray<RenderComponent>& render_components = global_->entity_list.components<RenderComponent>();
+  const RenderComponent* render_component = render_components.items;
+  const RenderComponent* render_component_end = render_component + render_components.used;
+  scope.set_entity_count(render_components.used);
 
   const auto main_shader_handle = global_->main_shader_handle;
 
@@ -192,6 +377,8 @@ void Loop::render() {
   renderer->shader_set_uniform(renderer->shader_uniform_location(main_shader_handle, "V"), view_matrix_);
   renderer->shader_set_uniform(renderer->shader_uniform_location(main_shader_handle, "P"), projection_matrix_);
 
+  const int32_t transform_location = renderer->shader_uniform_location(main_shader_handle, "T");
+
   while (render_component < render_component_end) {
 
     /* renderer->shader_set_uniform(renderer->shader_uniform_location(main_shader_handle, "M"), planet_world_matrix_);
@@ -199,7 +386,8 @@ void Loop::render() {
      renderer->shader_set_uniform(renderer->shader_uniform_location(main_shader_handle, "P"), background_projection_matrix_);
      renderer->render_vertex_array(planet_va_index);*/
 
-    renderer->shader_set_uniform(renderer->shader_uniform_location(main_shader_handle, "M"), render_component->world_transform);
+    const Math::Transform2D& transform = render_component->transform;
+    renderer->shader_set_uniform(transform_location, Math::V4{transform.x, transform.y, transform.rotation, transform.scale});
     renderer->render_vertex_array(render_component->vertex_array_idx);
 
     render_component++;
@@ -215,7 +403,7 @@ void Loop::render() {
     physics_component++;
   }
   
-  Debug::render_quadtree(&entity_tree_);
+  Debug::render_quadtree(&entity_tree_, System::memory_scratch_arena());
   */
   renderer->end_frame();
 }
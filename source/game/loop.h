@@ -3,6 +3,7 @@
 
 #include "global.h"
 #include "quadtree.h"
+#include "linear_quadtree.h"
 
 #include "math/matrix4.h"
 
@@ -10,6 +11,23 @@ namespace Asteroids {
 namespace Game {
 
 constexpr int32_t MAX_COLLIDING_ENTITIES = 15;
+constexpr int32_t QUADTREE_MAX_DEPTH = 10;
+
+using PhysicsRenderView = EntityView<PhysicsComponent, RenderComponent>;
+
+// Every stage of a frame is timed as its own profiler system.
+enum LoopSystem : int32_t {
+  LOOP_SYSTEM_PLAYER,
+  LOOP_SYSTEM_INTEGRATION,
+  LOOP_SYSTEM_SPATIAL_INDEX,
+  LOOP_SYSTEM_COLLISION,
+  LOOP_SYSTEM_COMMANDS,
+  LOOP_SYSTEM_LIFETIME,
+  LOOP_SYSTEM_COMPACT,
+  LOOP_SYSTEM_SPATIAL_SORT,
+  LOOP_SYSTEM_RENDER,
+  LOOP_SYSTEM_COUNT,
+};
 
 class Loop final {
   DISABLE_COPY_AND_MOVE(Loop);
@@ -28,12 +46,15 @@ private:
   void update(float delta_time);
 
   Math::V3 update_player_entity(const Entity* entity, float delta_time);
-  void update_entity(const Entity* entity, float delat_time);
+  // Refreshes the render transform when physics or render changed, and inserts or relocates it in the pointer tree.
+  void update_entity(EcsId entity_id, int32_t physics_idx, int32_t render_idx);
+  void integrate_positions(PhysicsComponentArrays* physics, int32_t begin, int32_t end, float delta_time);
   void update_view_projection(const Math::V3& player_position);
 
   void render();
 
-  void find_colliding_entities(QTNode* node);
+  // Returns the number of live candidates around aabb, the same set the linear tree visits.
+  int32_t find_colliding_entities(const Math::AABB& aabb);
 
 private:
   Global* global_ = nullptr;
@@ -50,6 +71,11 @@ private:
   Math::M4 background_projection_matrix_;
 
   QuadTree entity_tree_;
+  LinearQuadTree linear_tree_;
+  int32_t frames_since_spatial_sort_ = 0;
+
+  int32_t profiler_ids_[LOOP_SYSTEM_COUNT] = {};
+  int32_t frames_since_profiler_dump_ = 0;
 };
 
 } //namespace
@@ -8,7 +8,7 @@ bool QuadTree::init(System::MemoryArena* arena, int32_t max_depth, float max_hal
   ASSERT(arena && arena->allocated_size > sizeof(QTNode) && max_depth >= 1);
   arena_ = arena;
 
-  root_ = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+  root_ = (QTNode*)System::memory_arena_alloc_zeroed(arena_, 1, sizeof(QTNode));
   if (!root_) {
     return false;
   }
@@ -17,16 +17,206 @@ bool QuadTree::init(System::MemoryArena* arena, int32_t max_depth, float max_hal
   root_->aabb.pos.y = 0.0F;
   root_->aabb.pos.z = 0.0F;
   root_->aabb.half_edge = max_half_edge;
+  root_->depth = 1;
 
   max_depth_ = max_depth;
   return true;
 }
 
+bool QuadTree::init_incremental(System::MemoryArena* arena, int32_t max_depth, float max_half_edge, int32_t max_entities) {
+  ASSERT(arena && max_depth >= 1 && max_entities > 0);
+  arena_ = arena;
+
+  // Every entity keeps one path of max_depth nodes alive, plus the one it left until the next merge.
+  const int32_t max_nodes = 2 * max_entities * max_depth + 1;
+  entries_ = System::arena_push<EcsIdNode*>(arena_, max_entities);
+  if (!entries_
+    || !node_pool_.init(arena_, max_nodes)
+    || !entry_pool_.init(arena_, max_entities)
+    || !merge_queue_.init(arena_, max_nodes)) {
+    entries_ = nullptr;
+    return false;
+  }
+
+  memset(entries_, 0, max_entities * sizeof(EcsIdNode*));
+  max_entities_ = max_entities;
+
+  root_ = alloc_node(nullptr);
+  if (!root_) {
+    entries_ = nullptr;
+    return false;
+  }
+
+  root_->aabb.pos = Math::V3{0.0F, 0.0F, 0.0F};
+  root_->aabb.half_edge = max_half_edge;
+
+  max_depth_ = max_depth;
+  return true;
+}
+
+// The nodes live in an arena owned by the caller, nothing is released here.
 void QuadTree::finalize() {
-  System::memory_arena_reset(arena_);
+  root_ = nullptr;
+  arena_ = nullptr;
+  entries_ = nullptr;
+  max_entities_ = 0;
 }
 
-bool QuadTree::insert(EcsId entity_id, const Math::AABB& aabb) {
+QTNode* QuadTree::alloc_node(QTNode* parent) {
+  QTNode* node = entries_ ? node_pool_.alloc() : (QTNode*)System::memory_arena_alloc_zeroed(arena_, 1, sizeof(QTNode));
+  if (node) {
+    node->parent = parent;
+    node->depth = parent ? parent->depth + 1 : 1;
+  }
+
+  return node;
+}
+
+// An entity stays put while its node contains it and it still straddles the node's centre lines, otherwise
+// the insert path would have put it in a child.
+bool QuadTree::fits_node(const QTNode* node, const Math::AABB& aabb) const {
+  if (!node->aabb.contains_xy(aabb)) {
+    return false;
+  }
+
+  if (node->depth >= max_depth_) {
+    return true;
+  }
+
+  const Math::V3& centre = node->aabb.pos;
+  const bool straddles_x = (aabb.pos.x - aabb.half_edge) < centre.x && (aabb.pos.x + aabb.half_edge) > centre.x;
+  const bool straddles_y = (aabb.pos.y - aabb.half_edge) < centre.y && (aabb.pos.y + aabb.half_edge) > centre.y;
+  return straddles_x || straddles_y;
+}
+
+bool QuadTree::update(EntityHandle entity, const Math::AABB& aabb) {
+  ASSERT(incremental());
+  ASSERT(entity.index >= 0 && entity.index < max_entities_);
+
+  EcsIdNode* entry = entries_[entity.index];
+  QTNode* node = root_;
+
+  if (entry) {
+    if (entry->id.generation == entity.generation && fits_node(entry->node, aabb)) {
+      return true;
+    }
+
+    // Moved out, or the slot was reused by a new entity. Either way the search starts from where it was.
+    node = entry->node;
+    unlink(entry);
+  }
+
+  while (node->parent && !node->aabb.contains_xy(aabb)) {
+    node = node->parent;
+  }
+
+  QTNode* target = node->aabb.contains_xy(aabb) ? try_subdivide(node, aabb, node->depth) : nullptr;
+  if (!target) {
+    if (entry) {
+      entry_pool_.free(entry);
+      entries_[entity.index] = nullptr;
+    }
+
+    return false;
+  }
+
+  if (!entry) {
+    entry = entry_pool_.alloc();
+    if (!entry) {
+      return false;
+    }
+
+    entries_[entity.index] = entry;
+  }
+
+  entry->id = entity;
+  entry->node = target;
+  entry->prev = nullptr;
+  entry->next = target->entity_list;
+  if (entry->next) {
+    entry->next->prev = entry;
+  }
+
+  target->entity_list = entry;
+  return true;
+}
+
+void QuadTree::remove(EcsId entity_id) {
+  ASSERT(incremental());
+  ASSERT(entity_id >= 0 && entity_id < max_entities_);
+
+  EcsIdNode* entry = entries_[entity_id];
+  if (entry) {
+    unlink(entry);
+    entry_pool_.free(entry);
+    entries_[entity_id] = nullptr;
+  }
+}
+
+void QuadTree::unlink(EcsIdNode* entry) {
+  QTNode* node = entry->node;
+
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    node->entity_list = entry->next;
+  }
+
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  }
+
+  entry->node = nullptr;
+  queue_merge(node);
+}
+
+void QuadTree::queue_merge(QTNode* node) {
+  const bool empty = !node->entity_list && !node->nw_child && !node->ne_child && !node->sw_child && !node->se_child;
+  if (empty && node != root_ && !node->merge_pending) {
+    node->merge_pending = true;
+    merge_queue_.push(node);
+  }
+}
+
+int32_t QuadTree::merge_empty_nodes() {
+  ASSERT(incremental());
+
+  int32_t merged = 0;
+  while (!merge_queue_.empty()) {
+    QTNode* node = merge_queue_[merge_queue_.size() - 1];
+    merge_queue_.pop();
+    node->merge_pending = false;
+
+    // Refilled or subdivided again since it was queued.
+    if (node->entity_list || node->nw_child || node->ne_child || node->sw_child || node->se_child) {
+      continue;
+    }
+
+    QTNode* parent = node->parent;
+    if (parent->nw_child == node) {
+      parent->nw_child = nullptr;
+    } else if (parent->ne_child == node) {
+      parent->ne_child = nullptr;
+    } else if (parent->sw_child == node) {
+      parent->sw_child = nullptr;
+    } else {
+      ASSERT(parent->se_child == node);
+      parent->se_child = nullptr;
+    }
+
+    node_pool_.free(node);
+    merged++;
+
+    queue_merge(parent);
+  }
+
+  return merged;
+}
+
+bool QuadTree::insert(EntityHandle entity, const Math::AABB& aabb) {
+  if (incremental()) {
+    return update(entity, aabb);
+  }
 
   if (root_->aabb.contains_xy(aabb)) {
     QTNode* node = try_subdivide(root_, aabb, 1);
@@ -40,13 +230,15 @@ bool QuadTree::insert(EcsId entity_id, const Math::AABB& aabb) {
 
         last->next = (EcsIdNode*)System::memory_arena_alloc(arena_, 1, sizeof(EcsIdNode));
         if (last->next) {
-          last->next->id = entity_id;
+          last->next->id = entity;
+          last->next->next = nullptr;
           return true;
         }
       } else {
         node->entity_list = (EcsIdNode*)System::memory_arena_alloc(arena_, 1, sizeof(EcsIdNode));
         if (node->entity_list) {
-          node->entity_list->id = entity_id;
+          node->entity_list->id = entity;
+          node->entity_list->next = nullptr;
           return true;
         }
       }
@@ -75,7 +267,7 @@ QTNode* QuadTree::try_subdivide(QTNode* node, const Math::AABB& aabb, int32_t de
       new_aabb.pos.z = 0.0F;
 
       if (new_aabb.contains_xy(aabb)) {
-        node->nw_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+        node->nw_child = alloc_node(node);
         if (!node->nw_child) {
           return nullptr;
         }
@@ -95,7 +287,7 @@ QTNode* QuadTree::try_subdivide(QTNode* node, const Math::AABB& aabb, int32_t de
       new_aabb.pos.z = 0.0F;
 
       if (new_aabb.contains_xy(aabb)) {
-        node->ne_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+        node->ne_child = alloc_node(node);
         if (!node->ne_child) {
           return nullptr;
         }
@@ -115,7 +307,7 @@ QTNode* QuadTree::try_subdivide(QTNode* node, const Math::AABB& aabb, int32_t de
       new_aabb.pos.z = 0.0F;
 
       if (new_aabb.contains_xy(aabb)) {
-        node->se_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+        node->se_child = alloc_node(node);
         if (!node->se_child) {
           return nullptr;
         }
@@ -135,7 +327,7 @@ QTNode* QuadTree::try_subdivide(QTNode* node, const Math::AABB& aabb, int32_t de
       new_aabb.pos.z = 0.0F;
 
       if (new_aabb.contains_xy(aabb)) {
-        node->sw_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+        node->sw_child = alloc_node(node);
         if (!node->sw_child) {
           return nullptr;
         }
@@ -153,7 +345,7 @@ bool QuadTree::subdivide(QTNode* node, int32_t depth) {
 
   const float child_half_edge = node->aabb.half_edge * 0.5F;
 
-  node->nw_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+  node->nw_child = alloc_node(node);
   if (!node->nw_child) {
     return false;
   }
@@ -163,7 +355,7 @@ bool QuadTree::subdivide(QTNode* node, int32_t depth) {
   node->nw_child->aabb.pos.z = 0.0F;
   node->nw_child->aabb.half_edge = child_half_edge;
 
-  node->ne_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+  node->ne_child = alloc_node(node);
   if (!node->ne_child) {
     return false;
   }
@@ -173,7 +365,7 @@ bool QuadTree::subdivide(QTNode* node, int32_t depth) {
   node->ne_child->aabb.pos.z = 0.0F;
   node->ne_child->aabb.half_edge = child_half_edge;
 
-  node->sw_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+  node->sw_child = alloc_node(node);
   if (!node->sw_child) {
     return false;
   }
@@ -183,7 +375,7 @@ bool QuadTree::subdivide(QTNode* node, int32_t depth) {
   node->sw_child->aabb.pos.z = 0.0F;
   node->sw_child->aabb.half_edge = child_half_edge;
 
-  node->se_child = (QTNode*)System::memory_arena_alloc(arena_, 1, sizeof(QTNode));
+  node->se_child = alloc_node(node);
   if (!node->se_child) {
     return false;
   }
@@ -2,24 +2,31 @@
 #pragma once
 
 #include "system/memory.h"
+#include "system/containers.h"
+#include "system/pool.h"
 
 #include "math/aabb.h"
 
-#include "rendering/renderer.h"
-
 #include "ecs.h"
 
 namespace Asteroids {
 namespace Game {
 
+struct QTNode;
+
 struct EcsIdNode {
-  EcsId id;
+  EntityHandle id;
   EcsIdNode* next;
+  EcsIdNode* prev; // Incremental mode only, with node it unlinks an entity without walking the list
+  QTNode* node;
 };
 
 struct QTNode {
   Math::AABB aabb;
   EcsIdNode* entity_list;
+  QTNode* parent;
+  int32_t depth; // The root is 1
+  bool merge_pending;
 
   QTNode* nw_child;
   QTNode* ne_child;
@@ -36,9 +43,31 @@ public:
   bool init(System::MemoryArena* arena, int32_t max_depth, float max_half_edge);
   void finalize();
 
-  bool insert(EcsId entity_id, const Math::AABB& aabb);
+  // Incremental mode keeps the tree across frames. Nodes and entries come from pools over arena and are
+  // recycled, every entity is tracked by id so update() only relocates it once its AABB leaves its node.
+  bool init_incremental(System::MemoryArena* arena, int32_t max_depth, float max_half_edge, int32_t max_entities);
+
+  bool insert(EntityHandle entity, const Math::AABB& aabb);
   QTNode* query(const Math::AABB& aabb);
 
+  // Calls f(EntityHandle) for the candidates LinearQuadTree::query visits, the nodes on the path down to
+  // the deepest cell holding aabb plus that cell's subtree. A cell the tree never split down to has no
+  // subtree and adds nothing. Returns the number of entities visited.
+  template <typename F> int32_t query_candidates(const Math::AABB& aabb, F&& f) const;
+
+  // Incremental mode only. update() inserts an entity the tree does not hold yet and relocates one whose AABB
+  // no longer fits its node, or would now fit one of its children. Returns false when the AABB is outside
+  // the tree, the entity is not held then. Nodes left empty are queued and released by merge_empty_nodes().
+  bool update(EntityHandle entity, const Math::AABB& aabb);
+  void remove(EcsId entity_id);
+
+  // Releases queued nodes that are still empty and childless, then their parents as they empty in turn.
+  // Returns the number of nodes released.
+  int32_t merge_empty_nodes();
+
+  bool incremental() const { return entries_ != nullptr; }
+  int32_t node_count() const { return node_pool_.live_count(); }
+
   bool subdivide(QTNode* node, int32_t depth);
   QTNode* try_subdivide(QTNode* node, const Math::AABB& aabb, int32_t depth);
 
@@ -48,7 +77,78 @@ public:
   int32_t max_depth_ = 0;
 
   System::MemoryArena* arena_ = nullptr;
+
+private:
+  template <typename F> static int32_t visit_node(const QTNode* node, F& f);
+  template <typename F> static int32_t visit_subtree(const QTNode* node, F& f);
+
+  QTNode* alloc_node(QTNode* parent);
+  bool fits_node(const QTNode* node, const Math::AABB& aabb) const;
+  void unlink(EcsIdNode* entry);
+  void queue_merge(QTNode* node);
+
+  System::Pool<QTNode> node_pool_;
+  System::Pool<EcsIdNode> entry_pool_;
+  EcsIdNode** entries_ = nullptr; // By entity id, nullptr when the entity is not in the tree
+  int32_t max_entities_ = 0;
+  System::ArenaArray<QTNode*> merge_queue_;
 };
 
+template <typename F> int32_t QuadTree::visit_node(const QTNode* node, F& f) {
+  int32_t visited = 0;
+  for (const EcsIdNode* id_node = node->entity_list; id_node; id_node = id_node->next) {
+    f(id_node->id);
+    visited++;
+  }
+
+  return visited;
+}
+
+template <typename F> int32_t QuadTree::visit_subtree(const QTNode* node, F& f) {
+  int32_t visited = visit_node(node, f);
+  const QTNode* children[4] = {node->nw_child, node->ne_child, node->sw_child, node->se_child};
+  for (const QTNode* child : children) {
+    if (child) {
+      visited += visit_subtree(child, f);
+    }
+  }
+
+  return visited;
+}
+
+template <typename F> int32_t QuadTree::query_candidates(const Math::AABB& aabb, F&& f) const {
+  int32_t visited = 0;
+  const QTNode* node = root_;
+
+  while (node) {
+    if (node->depth >= max_depth_) {
+      return visited + visit_subtree(node, f);
+    }
+
+    // The child cells, whether or not the node was split into them. Same order as the children.
+    const float child_half_edge = node->aabb.half_edge * 0.5F;
+    const float offsets[4][2] = {{-1.0F, 1.0F}, {1.0F, 1.0F}, {-1.0F, -1.0F}, {1.0F, -1.0F}};
+    const QTNode* children[4] = {node->nw_child, node->ne_child, node->sw_child, node->se_child};
+
+    int32_t quadrant = -1;
+    for (int32_t q = 0; q < 4 && quadrant < 0; q++) {
+      const Math::AABB cell = {Math::V3{node->aabb.pos.x + offsets[q][0] * child_half_edge,
+        node->aabb.pos.y + offsets[q][1] * child_half_edge, 0.0F}, child_half_edge};
+      if (cell.contains_xy(aabb)) {
+        quadrant = q;
+      }
+    }
+
+    if (quadrant < 0) {
+      return visited + visit_subtree(node, f);
+    }
+
+    visited += visit_node(node, f);
+    node = children[quadrant];
+  }
+
+  return visited;
+}
+
 } //namespace
 } //namespace
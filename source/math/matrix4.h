@@ -7,7 +7,7 @@ namespace Asteroids {
 namespace Math {
 // Column major 4 by 4 matrix
 
-struct M4 {
+struct alignas(16) M4 {
   float m[16];
 };
 
@@ -0,0 +1,44 @@
+// morton.h
+#pragma once
+
+#include "math.h"
+
+namespace Asteroids {
+namespace Math {
+
+constexpr uint32_t MORTON_AXIS_BITS = 16;
+constexpr uint32_t MORTON_AXIS_MAX = (1U << MORTON_AXIS_BITS) - 1;
+
+// Spreads the low 16 bits of v to the even bits of the result.
+inline uint32_t morton_spread_bits(uint32_t v) {
+  v &= 0x0000FFFF;
+  v = (v | (v << 8)) & 0x00FF00FF;
+  v = (v | (v << 4)) & 0x0F0F0F0F;
+  v = (v | (v << 2)) & 0x33333333;
+  v = (v | (v << 1)) & 0x55555555;
+  return v;
+}
+
+inline uint32_t morton_encode(uint32_t x, uint32_t y) {
+  return morton_spread_bits(x) | (morton_spread_bits(y) << 1);
+}
+
+// Quantizes value in [min, min + extent] to 16 bits, values outside are clamped to the edge.
+inline uint32_t morton_quantize(float value, float min, float extent) {
+  const float t = extent > 0.0F ? (value - min) / extent : 0.0F;
+  const float clamped = t < 0.0F ? 0.0F : (t > 1.0F ? 1.0F : t);
+  return uint32_t(clamped * float(MORTON_AXIS_MAX));
+}
+
+// Neighbours in the XY plane get nearby codes, sorting by it gives Z-order. The square starting at
+// (min_x, min_y) with edge extent is the quantization grid.
+inline uint32_t morton_code(float x, float y, float min_x, float min_y, float extent) {
+  return morton_encode(morton_quantize(x, min_x, extent), morton_quantize(y, min_y, extent));
+}
+
+inline uint32_t morton_code(float x, float y, float half_edge) {
+  return morton_code(x, y, -half_edge, -half_edge, 2.0F * half_edge);
+}
+
+} //namespace
+} //namespace
@@ -6,6 +6,17 @@
 namespace Asteroids {
 namespace Math {
 
+// Everything in the game lives in the XY plane, scale is uniform and rotation is around Z.
+// 16 bytes per entity, the vertex shader expands it, transform_2d() builds the matrix where one is needed.
+struct Transform2D {
+  float x;
+  float y;
+  float rotation;
+  float scale;
+};
+
+constexpr Transform2D TRANSFORM_2D_IDENTITY = {0.0F, 0.0F, 0.0F, 1.0F};
+
 inline M4 translate(const V3& p) {
   return M4{{
     1, 0, 0, 0,
@@ -60,6 +71,19 @@ inline M4 scale(float x, float y, float z) {
   }};
 }
 
+// Same as scale(t.scale) * rotate_z_axis(-t.rotation) * translate(V3{t.x, t.y, 0}).
+inline M4 transform_2d(const Transform2D& t) {
+  const float c = Math::cos(t.rotation) * t.scale;
+  const float s = Math::sin(t.rotation) * t.scale;
+
+  return M4{{
+    c, s, 0, 0,
+    -s, c, 0, 0,
+    0, 0, t.scale, 0,
+    t.x, t.y, 0, 1,
+  }};
+}
+
 inline M4 orthographic(float left, float right, float bottom, float top,  float near, float far) {
 
   const float h_factor = 1.0F / (right -  left);
@@ -14,13 +14,7 @@ bool MeshBuilder::init(System::MemoryArena* arena, size_t max_mesh_count) {
 
   mesh_arena = arena;
 
-  mesh_list_ = (TriangleMesh*)System::memory_arena_alloc(mesh_arena, max_mesh_count, sizeof(TriangleMesh));
-  if (!mesh_list_) {
-    return false;
-  }
-
-  mesh_max_count_ = max_mesh_count;
-  return true;
+  return mesh_list_.init(mesh_arena, max_mesh_count);
 }
 
 void MeshBuilder::finalize() {
@@ -28,16 +22,25 @@ void MeshBuilder::finalize() {
 
 TriangleMesh* MeshBuilder::mesh_from_obj(const System::ByteBuffer* buffer, size_t max_vertex_count, size_t max_triangle_count) {
   ASSERT(is_valid(buffer));
-  ASSERT(mesh_used_count_ < mesh_max_count_);
+  ASSERT(!mesh_list_.full());
 
-  if (mesh_used_count_ >= mesh_max_count_) {
-    System::log_error("Mesh list is too small [%u]", mesh_max_count_);
+  if (mesh_list_.full()) {
+    System::log_error("Mesh list is too small [%d]", mesh_list_.capacity());
     return nullptr;
   }
 
-  TriangleMesh* mesh = &mesh_list_[mesh_used_count_];
-  mesh->vertices = (Vertex*)System::memory_arena_alloc(mesh_arena, max_vertex_count, sizeof(Vertex));
-  mesh->triangles = (Triangle*)System::memory_arena_alloc(mesh_arena, max_triangle_count, sizeof(Triangle));
+  // Parse into max sized arrays, trimmed to the real counts once the mesh is read.
+  const System::ArenaMarker marker = System::memory_arena_marker(mesh_arena);
+
+  TriangleMesh mesh_data = {};
+  TriangleMesh* mesh = &mesh_data;
+  mesh->vertices = System::arena_push<Vertex>(mesh_arena, max_vertex_count);
+  mesh->triangles = System::arena_push<Triangle>(mesh_arena, max_triangle_count);
+
+  if (!mesh->vertices || !mesh->triangles) {
+    System::memory_arena_restore(marker);
+    return nullptr;
+  }
 
   const char* buffer_end = (char*)buffer->bytes + buffer->size;
   const char* line_start = (char*)buffer->bytes;
@@ -78,6 +81,7 @@ TriangleMesh* MeshBuilder::mesh_from_obj(const System::ByteBuffer* buffer, size_
         }
       } else {
         System::log_error("Mesh vertex position array is too small [%u]", max_vertex_count);
+        System::memory_arena_restore(marker);
         return nullptr;
       }
    /* } else if (strncmp(line, "vn ", 3) == 0) {
@@ -118,6 +122,7 @@ TriangleMesh* MeshBuilder::mesh_from_obj(const System::ByteBuffer* buffer, size_
         }
       } else {
         System::log_error("Mesh triangle array is too small [%u]", max_triangle_count);
+        System::memory_arena_restore(marker);
         return nullptr;
       }
     }
@@ -126,8 +131,18 @@ TriangleMesh* MeshBuilder::mesh_from_obj(const System::ByteBuffer* buffer, size_
   //ASSERT(vertex_position_count == vertex_normal_count);
   mesh->vertex_count = vertex_position_count;
 
-  mesh_used_count_++;
-  return mesh;
+  if (mesh->vertex_count > 0 && mesh->triangle_count > 0) {
+    System::memory_arena_restore(marker);
+
+    Vertex* vertices = System::arena_push<Vertex>(mesh_arena, mesh->vertex_count);
+    ASSERT(vertices == mesh->vertices);
+
+    Triangle* triangles = System::arena_push<Triangle>(mesh_arena, mesh->triangle_count);
+    memmove(triangles, mesh->triangles, mesh->triangle_count * sizeof(Triangle));
+    mesh->triangles = triangles;
+  }
+
+  return mesh_list_.push(mesh_data);
 }
 
 } //namespace
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "system/fileio.h"
+#include "system/containers.h"
 #include "math/vector3.h"
 #include "math/matrix4.h"
 #include "math/aabb.h"
@@ -38,9 +39,7 @@ public:
 private:
   System::MemoryArena* mesh_arena = nullptr;
 
-  TriangleMesh* mesh_list_ = nullptr;
-  size_t mesh_max_count_ = 0;
-  size_t mesh_used_count_ = 0;
+  System::ArenaArray<TriangleMesh> mesh_list_;
 };
 
 } //namespace
@@ -18,12 +18,10 @@ bool Renderer::init(System::MemoryArena* arena) {
 
 void Renderer::finalize() {
 
-  if (vertex_array_list_ && vertex_array_used_count_ > 0) {
-    for (int i = 0; i < vertex_array_used_count_; i++) {
-      glDeleteVertexArrays(1, (GLuint*)&vertex_array_list_[i].ebo);
-      glDeleteVertexArrays(1, (GLuint*)&vertex_array_list_[i].vbo);
-      glDeleteVertexArrays(1, (GLuint*)&vertex_array_list_[i].vao);
-    }
+  for (GlVertexArray& va : vertex_array_list_) {
+    glDeleteVertexArrays(1, (GLuint*)&va.ebo);
+    glDeleteVertexArrays(1, (GLuint*)&va.vbo);
+    glDeleteVertexArrays(1, (GLuint*)&va.vao);
   }
 
 }
@@ -86,13 +84,7 @@ bool Renderer::init_opengl() {
 
 bool Renderer::init_vertex_array_list(size_t max_vertex_array_count) {
   ASSERT(renderer_arena);
-  vertex_array_list_ = (GlVertexArray*)System::memory_arena_alloc(renderer_arena, max_vertex_array_count, sizeof(GlVertexArray));
-  if (vertex_array_list_) {
-    vertex_array_max_count_ = max_vertex_array_count;
-    return true;
-  }
-
-  return false;
+  return vertex_array_list_.init(renderer_arena, max_vertex_array_count);
 }
 
 uint32_t Renderer::build_shader_program(
@@ -157,13 +149,17 @@ void Renderer::shader_set_uniform(int32_t uniform_location, const Math::M4& m) {
   glUniformMatrix4fv(uniform_location, 1, GL_FALSE, m.m);
 }
 
+void Renderer::shader_set_uniform(int32_t uniform_location, const Math::V4& v) {
+  glUniform4fv(uniform_location, 1, v.v);
+}
+
 int32_t Renderer::build_vertex_array(const TriangleMesh* mesh) {
   ASSERT(mesh);
-  ASSERT(vertex_array_list_ && vertex_array_max_count_);
-  ASSERT(vertex_array_used_count_ + 1 <= vertex_array_max_count_);
+  ASSERT(vertex_array_list_.capacity() > 0);
+  ASSERT(!vertex_array_list_.full());
 
   GlVertexArray va = {};
-  const size_t vertex_array_index = vertex_array_used_count_;
+  const int32_t vertex_array_index = vertex_array_list_.size();
 
   glGenVertexArrays(1, &va.vao);
   glGenBuffers(1, &va.vbo);
@@ -188,8 +184,7 @@ int32_t Renderer::build_vertex_array(const TriangleMesh* mesh) {
 
   va.element_count = mesh->triangle_count * 3;
 
-  vertex_array_list_[vertex_array_index] = va;
-  vertex_array_used_count_++;
+  vertex_array_list_.push(va);
   
   return vertex_array_index;
 }
@@ -211,10 +206,9 @@ void Renderer::use_shader_program(uint32_t shader_handle) {
 }
 
 void Renderer::render_vertex_array(size_t index) {
-  ASSERT(index < vertex_array_used_count_);
-
-  glBindVertexArray(vertex_array_list_[index].vao);
-  glDrawElements(GL_TRIANGLES, vertex_array_list_[index].element_count, GL_UNSIGNED_INT, 0);
+  const GlVertexArray& va = vertex_array_list_[index];
+  glBindVertexArray(va.vao);
+  glDrawElements(GL_TRIANGLES, va.element_count, GL_UNSIGNED_INT, 0);
   glBindVertexArray(0);
 }
 
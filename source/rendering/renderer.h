@@ -1,6 +1,7 @@
 // renderer.h
 #pragma once
 #include "system/memory.h"
+#include "system/containers.h"
 
 #include "math/vector3.h"
 #include "math/matrix4.h"
@@ -47,6 +48,7 @@ public:
 
   int32_t shader_uniform_location(uint32_t shader_handle, const char* uniform_name);
   void shader_set_uniform(int32_t uniform_location, const Math::M4& m);
+  void shader_set_uniform(int32_t uniform_location, const Math::V4& v);
 
   void begin_frame();
   void end_frame();
@@ -65,9 +67,7 @@ private:
 
   System::MemoryArena* renderer_arena = nullptr;
 
-  GlVertexArray* vertex_array_list_ = nullptr;
-  size_t vertex_array_max_count_ = 0;
-  size_t vertex_array_used_count_ = 0;
+  System::ArenaArray<GlVertexArray> vertex_array_list_;
 
   //Debug
   uint32_t aabb_vao_ = uint32_t(-1);
@@ -0,0 +1,277 @@
+// alloc_verifier.cpp
+#include "alloc_verifier.h"
+
+#ifdef VERIFY_FRAME_ALLOCS
+
+#include <errno.h>
+#include <new>
+
+namespace Asteroids {
+namespace System {
+
+constexpr int32_t MAX_ALLOC_VERIFIER_SCOPES = 16;
+constexpr int32_t MAX_ALLOC_VERIFIER_SCOPE_DEPTH = 8;
+
+struct AllocVerifierCounts {
+  const char* scope;
+  size_t heap_count;
+  size_t heap_size;
+  size_t arena_count;
+  size_t arena_size;
+};
+
+static AllocVerifierCounts scopes[MAX_ALLOC_VERIFIER_SCOPES] = {};
+static int32_t scope_count = 0;
+static int32_t scope_stack[MAX_ALLOC_VERIFIER_SCOPE_DEPTH] = {};
+static int32_t scope_depth = 0;
+
+static int32_t warmup = 0;
+static bool abort_on_frame_alloc = false;
+static uint64_t frame = 0;
+
+// Only the thread running the frame is verified, audio and driver threads allocate on their own schedule.
+static thread_local bool verified_thread = false;
+static thread_local bool reporting = false;
+
+static AllocVerifierCounts* current_scope() {
+  if (scope_count == 0) {
+    scopes[0].scope = "FRAME";
+    scope_count = 1;
+  }
+
+  return &scopes[scope_depth > 0 ? scope_stack[scope_depth - 1] : 0];
+}
+
+void alloc_verifier_init(int32_t warmup_frames, bool abort_on_alloc) {
+  warmup = warmup_frames;
+  abort_on_frame_alloc = abort_on_alloc;
+  log_info("Frame allocation verifier: %d warmup frames", warmup);
+}
+
+void alloc_verifier_begin_frame() {
+  verified_thread = true;
+  frame++;
+}
+
+void alloc_verifier_end_frame() {
+  ASSERT(scope_depth == 0);
+
+  bool allocated = false;
+  reporting = true;
+
+  for (int32_t i = 0; i < scope_count; i++) {
+    AllocVerifierCounts* counts = &scopes[i];
+
+    if (frame > uint64_t(warmup) && (counts->heap_count > 0 || counts->arena_count > 0)) {
+      log_error("Frame %llu [%s]: %zu heap allocations (%zu bytes), %zu arena allocations (%zu bytes)",
+        (unsigned long long)frame, counts->scope,
+        counts->heap_count, counts->heap_size, counts->arena_count, counts->arena_size);
+      allocated = true;
+    }
+
+    counts->heap_count = 0;
+    counts->heap_size = 0;
+    counts->arena_count = 0;
+    counts->arena_size = 0;
+  }
+
+  reporting = false;
+
+  if (allocated && abort_on_frame_alloc) {
+    abort();
+  }
+}
+
+void alloc_verifier_push_scope(const char* name) {
+  ASSERT(scope_depth < MAX_ALLOC_VERIFIER_SCOPE_DEPTH);
+  current_scope();
+
+  int32_t index = 0;
+  while (index < scope_count && scopes[index].scope != name) {
+    index++;
+  }
+
+  if (index == scope_count) {
+    if (scope_count == MAX_ALLOC_VERIFIER_SCOPES) {
+      index = 0;
+    } else {
+      scopes[scope_count++].scope = name;
+    }
+  }
+
+  scope_stack[scope_depth++] = index;
+}
+
+void alloc_verifier_pop_scope() {
+  ASSERT(scope_depth > 0);
+  scope_depth--;
+}
+
+void alloc_verifier_count_heap(size_t size) {
+  if (verified_thread && !reporting) {
+    AllocVerifierCounts* counts = current_scope();
+    counts->heap_count++;
+    counts->heap_size += size;
+  }
+}
+
+void alloc_verifier_count_arena(size_t size) {
+  if (verified_thread && !reporting) {
+    AllocVerifierCounts* counts = current_scope();
+    counts->arena_count++;
+    counts->arena_size += size;
+  }
+}
+
+} //namespace
+} //namespace
+
+#if defined(__GLIBC__)
+
+// glibc lets the executable interpose the allocator, which also catches SDL and C library allocations.
+// Aligned allocations have their own entry points, aligned operator new ends up in aligned_alloc.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* memory, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+
+void* malloc(size_t size) noexcept {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  Asteroids::System::alloc_verifier_count_heap(count * size);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* memory, size_t size) noexcept {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  return __libc_realloc(memory, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** memory, size_t alignment, size_t size) noexcept {
+  if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0) {
+    return EINVAL;
+  }
+
+  Asteroids::System::alloc_verifier_count_heap(size);
+  void* aligned = __libc_memalign(alignment, size);
+  if (!aligned) {
+    return ENOMEM;
+  }
+
+  *memory = aligned;
+  return 0;
+}
+
+void* valloc(size_t size) noexcept {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size) noexcept {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  return __libc_pvalloc(size);
+}
+}
+
+#else
+
+void* operator new(size_t size) {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  void* memory = malloc(size ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+
+  return memory;
+}
+
+void* operator new[](size_t size) {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  void* memory = malloc(size ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+  free(memory);
+}
+
+// Only C++ allocations are seen here, malloc and friends called directly are not counted off glibc.
+#if defined(_WIN32)
+#define ALLOC_VERIFIER_ALIGNED_ALLOC(alignment, size) _aligned_malloc(size, alignment)
+#define ALLOC_VERIFIER_ALIGNED_FREE(memory) _aligned_free(memory)
+#else
+#define ALLOC_VERIFIER_ALIGNED_ALLOC(alignment, size) aligned_alloc(alignment, ((size) + (alignment) - 1) & ~((alignment) - 1))
+#define ALLOC_VERIFIER_ALIGNED_FREE(memory) free(memory)
+#endif
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  void* memory = ALLOC_VERIFIER_ALIGNED_ALLOC(size_t(alignment), size ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+
+  return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  Asteroids::System::alloc_verifier_count_heap(size);
+  void* memory = ALLOC_VERIFIER_ALIGNED_ALLOC(size_t(alignment), size ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+
+  return memory;
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+  ALLOC_VERIFIER_ALIGNED_FREE(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+  ALLOC_VERIFIER_ALIGNED_FREE(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+  ALLOC_VERIFIER_ALIGNED_FREE(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept {
+  ALLOC_VERIFIER_ALIGNED_FREE(memory);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+// alloc_verifier.h
+#pragma once
+
+#include "system.h"
+
+// Counts heap and long-lived arena allocations made by the main loop thread, per frame and per scope.
+// Once the warmup frames are over every allocating frame is reported, and aborts when asked to.
+// Compiled in with the ASTEROIDS_VERIFY_FRAME_ALLOCS CMake option, otherwise everything here is a no-op.
+// On glibc the C allocator is interposed, aligned entry points included. Elsewhere only operator new is
+// replaced, plain and aligned, so direct malloc calls go uncounted there.
+
+namespace Asteroids {
+namespace System {
+
+#ifdef VERIFY_FRAME_ALLOCS
+
+void alloc_verifier_init(int32_t warmup_frames, bool abort_on_alloc);
+void alloc_verifier_begin_frame();
+void alloc_verifier_end_frame();
+
+void alloc_verifier_push_scope(const char* name);
+void alloc_verifier_pop_scope();
+
+void alloc_verifier_count_heap(size_t size);
+void alloc_verifier_count_arena(size_t size);
+
+class AllocVerifierScope final {
+  DISABLE_COPY_AND_MOVE(AllocVerifierScope);
+public:
+  explicit AllocVerifierScope(const char* name) { alloc_verifier_push_scope(name); }
+  ~AllocVerifierScope() { alloc_verifier_pop_scope(); }
+};
+
+#define ALLOC_VERIFIER_SCOPE_CONCAT(a, b) a##b
+#define ALLOC_VERIFIER_SCOPE_NAME(line) ALLOC_VERIFIER_SCOPE_CONCAT(alloc_verifier_scope_, line)
+#define ALLOC_VERIFIER_SCOPE(name) System::AllocVerifierScope ALLOC_VERIFIER_SCOPE_NAME(__LINE__)(name)
+
+#else
+
+inline void alloc_verifier_init(int32_t, bool) {}
+inline void alloc_verifier_begin_frame() {}
+inline void alloc_verifier_end_frame() {}
+
+inline void alloc_verifier_push_scope(const char*) {}
+inline void alloc_verifier_pop_scope() {}
+
+inline void alloc_verifier_count_heap(size_t) {}
+inline void alloc_verifier_count_arena(size_t) {}
+
+#define ALLOC_VERIFIER_SCOPE(name) do {} while (0)
+
+#endif
+
+} //namespace
+} //namespace
@@ -0,0 +1,475 @@
+// containers.h
+#pragma once
+
+#include <atomic>
+#include <bit>
+
+#include "system.h"
+#include "memory.h"
+
+namespace Asteroids {
+namespace System {
+
+// Storage is aligned for 16 byte SIMD loads at least, more if T asks for it.
+constexpr size_t CONTAINER_MIN_ALIGNMENT = 16;
+
+template <typename T> constexpr size_t container_alignment() {
+  return alignof(T) > CONTAINER_MIN_ALIGNMENT ? alignof(T) : CONTAINER_MIN_ALIGNMENT;
+}
+
+// Fixed capacity array over arena memory. Elements are plain data, nothing is constructed or destroyed.
+// Index checks are ASSERTs, so they compile out of RELEASE builds.
+template <typename T> class ArenaArray final {
+  DISABLE_COPY_AND_MOVE(ArenaArray);
+public:
+  ArenaArray() = default;
+  ~ArenaArray() = default;
+
+  bool init(MemoryArena* arena, int32_t capacity) {
+    ASSERT(arena && capacity > 0);
+
+    items_ = arena_push<T>(arena, capacity, container_alignment<T>());
+    if (!items_) {
+      return false;
+    }
+
+    capacity_ = capacity;
+    size_ = 0;
+    return true;
+  }
+
+  T* push() {
+    ASSERT(size_ < capacity_);
+    if (size_ >= capacity_) {
+      return nullptr;
+    }
+
+    return &items_[size_++];
+  }
+
+  T* push(const T& item) {
+    T* slot = push();
+    if (slot) {
+      *slot = item;
+    }
+
+    return slot;
+  }
+
+  void pop() {
+    ASSERT(size_ > 0);
+    size_--;
+  }
+
+  // Moves the last element into index, returns the index the moved element came from.
+  int32_t swap_remove(int32_t index) {
+    ASSERT(index >= 0 && index < size_);
+    const int32_t last = --size_;
+    if (index != last) {
+      items_[index] = items_[last];
+    }
+
+    return last;
+  }
+
+  void clear() { size_ = 0; }
+
+  T& operator[](int32_t index) {
+    ASSERT(index >= 0 && index < size_);
+    return items_[index];
+  }
+
+  const T& operator[](int32_t index) const {
+    ASSERT(index >= 0 && index < size_);
+    return items_[index];
+  }
+
+  T* data() const { return items_; }
+  T* begin() const { return items_; }
+  T* end() const { return items_ + size_; }
+
+  int32_t size() const { return size_; }
+  int32_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == capacity_; }
+
+private:
+  T* items_ = nullptr;
+  int32_t size_ = 0;
+  int32_t capacity_ = 0;
+};
+
+// Fixed size bit set over arena memory, iteration visits set bits in ascending order one word at a time.
+class ArenaBitSet final {
+  DISABLE_COPY_AND_MOVE(ArenaBitSet);
+public:
+  ArenaBitSet() = default;
+  ~ArenaBitSet() = default;
+
+  bool init(MemoryArena* arena, int32_t bit_count) {
+    ASSERT(arena && bit_count > 0);
+
+    word_count_ = (bit_count + 63) / 64;
+    words_ = arena_push<uint64_t>(arena, word_count_, CONTAINER_MIN_ALIGNMENT);
+    if (!words_) {
+      return false;
+    }
+
+    bit_count_ = bit_count;
+    clear();
+    return true;
+  }
+
+  void set(int32_t index) {
+    ASSERT(index >= 0 && index < bit_count_);
+    words_[index >> 6] |= uint64_t(1) << (index & 63);
+  }
+
+  // Sets [begin, end) a word at a time.
+  void set_range(int32_t begin, int32_t end) {
+    ASSERT(begin >= 0 && begin <= end && end <= bit_count_);
+    if (begin == end) {
+      return;
+    }
+
+    const int32_t first_word = begin >> 6;
+    const int32_t last_word = (end - 1) >> 6;
+    const uint64_t first_mask = ~uint64_t(0) << (begin & 63);
+    const uint64_t last_mask = ~uint64_t(0) >> (63 - ((end - 1) & 63));
+
+    if (first_word == last_word) {
+      words_[first_word] |= first_mask & last_mask;
+      return;
+    }
+
+    words_[first_word] |= first_mask;
+    for (int32_t w = first_word + 1; w < last_word; w++) {
+      words_[w] = ~uint64_t(0);
+    }
+    words_[last_word] |= last_mask;
+  }
+
+  void reset(int32_t index) {
+    ASSERT(index >= 0 && index < bit_count_);
+    words_[index >> 6] &= ~(uint64_t(1) << (index & 63));
+  }
+
+  bool test(int32_t index) const {
+    ASSERT(index >= 0 && index < bit_count_);
+    return (words_[index >> 6] >> (index & 63)) & 1;
+  }
+
+  void clear() { memset(words_, 0, word_count_ * sizeof(uint64_t)); }
+
+  int32_t count() const {
+    int32_t bits = 0;
+    for (int32_t w = 0; w < word_count_; w++) {
+      bits += std::popcount(words_[w]);
+    }
+
+    return bits;
+  }
+
+  template <typename F> void for_each(F&& f) const {
+    for (int32_t w = 0; w < word_count_; w++) {
+      uint64_t word = words_[w];
+      while (word) {
+        f(w * 64 + std::countr_zero(word));
+        word &= word - 1;
+      }
+    }
+  }
+
+  int32_t size() const { return bit_count_; }
+
+private:
+  uint64_t* words_ = nullptr;
+  int32_t word_count_ = 0;
+  int32_t bit_count_ = 0;
+};
+
+inline uint64_t hash_key(uint64_t key) {
+  // splitmix64 finalizer
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  return key;
+}
+
+inline uint64_t hash_key(int64_t key) { return hash_key(uint64_t(key)); }
+inline uint64_t hash_key(uint32_t key) { return hash_key(uint64_t(key)); }
+inline uint64_t hash_key(int32_t key) { return hash_key(uint64_t(uint32_t(key))); }
+inline uint64_t hash_key(const void* key) { return hash_key(uint64_t(size_t(key))); }
+
+// Open addressing hash map with linear probing over arena memory. The capacity is rounded up to a power
+// of two and the map is full at 3/4 load. Removed entries leave tombstones that inserts reuse, when they
+// fill the table up to the load limit it is rehashed in place to drop them.
+template <typename K, typename V> class ArenaHashMap final {
+  DISABLE_COPY_AND_MOVE(ArenaHashMap);
+public:
+  ArenaHashMap() = default;
+  ~ArenaHashMap() = default;
+
+  bool init(MemoryArena* arena, int32_t max_count) {
+    ASSERT(arena && max_count > 0);
+
+    int32_t capacity = 16;
+    while (capacity * 3 / 4 < max_count) {
+      capacity <<= 1;
+    }
+
+    keys_ = arena_push<K>(arena, capacity, container_alignment<K>());
+    values_ = arena_push<V>(arena, capacity, container_alignment<V>());
+    states_ = arena_push<uint8_t>(arena, capacity, CONTAINER_MIN_ALIGNMENT);
+    if (!keys_ || !values_ || !states_) {
+      return false;
+    }
+
+    capacity_ = capacity;
+    clear();
+    return true;
+  }
+
+  // Returns the value slot for key, inserting it if missing. nullptr when the map is full.
+  V* put(const K& key) {
+    int32_t tombstone = NONE;
+    int32_t slot = int32_t(hash_key(key) & (capacity_ - 1));
+
+    for (int32_t probe = 0; probe < capacity_; probe++) {
+      if (states_[slot] == EMPTY) {
+        break;
+      }
+
+      if (states_[slot] == OCCUPIED && keys_[slot] == key) {
+        return &values_[slot];
+      }
+
+      if (states_[slot] == REMOVED && tombstone == NONE) {
+        tombstone = slot;
+      }
+
+      slot = (slot + 1) & (capacity_ - 1);
+    }
+
+    if (tombstone != NONE) {
+      slot = tombstone;
+    } else {
+      if (used_ >= max_used()) {
+        ASSERT(size_ < max_used());
+        if (size_ >= max_used()) {
+          return nullptr;
+        }
+
+        rehash_in_place();
+        return put(key);
+      }
+
+      used_++;
+    }
+
+    states_[slot] = OCCUPIED;
+    keys_[slot] = key;
+    size_++;
+    return &values_[slot];
+  }
+
+  bool put(const K& key, const V& value) {
+    V* slot = put(key);
+    if (slot) {
+      *slot = value;
+    }
+
+    return slot != nullptr;
+  }
+
+  V* find(const K& key) const {
+    const int32_t slot = find_slot(key);
+    return slot != NONE ? &values_[slot] : nullptr;
+  }
+
+  bool remove(const K& key) {
+    const int32_t slot = find_slot(key);
+    if (slot == NONE) {
+      return false;
+    }
+
+    states_[slot] = REMOVED;
+    size_--;
+    return true;
+  }
+
+  void clear() {
+    memset(states_, EMPTY, capacity_);
+    size_ = 0;
+    used_ = 0;
+  }
+
+  int32_t size() const { return size_; }
+  int32_t capacity() const { return capacity_; }
+
+private:
+  static constexpr int32_t NONE = -1;
+  static constexpr uint8_t EMPTY = 0;
+  static constexpr uint8_t OCCUPIED = 1;
+  static constexpr uint8_t REMOVED = 2;
+
+  static constexpr uint8_t PENDING = 3; // Only during rehash_in_place()
+
+  int32_t max_used() const { return capacity_ * 3 / 4; }
+
+  // Tombstones become empty and every entry is moved to its first free slot from home. An entry that lands
+  // on one not yet moved swaps with it and carries that one on, so every entry moves once.
+  void rehash_in_place() {
+    for (int32_t i = 0; i < capacity_; i++) {
+      states_[i] = states_[i] == OCCUPIED ? PENDING : EMPTY;
+    }
+
+    for (int32_t i = 0; i < capacity_; i++) {
+      if (states_[i] != PENDING) {
+        continue;
+      }
+
+      K key = keys_[i];
+      V value = values_[i];
+      states_[i] = EMPTY;
+
+      int32_t slot = int32_t(hash_key(key) & (capacity_ - 1));
+      for (;;) {
+        if (states_[slot] == OCCUPIED) {
+          slot = (slot + 1) & (capacity_ - 1);
+          continue;
+        }
+
+        if (states_[slot] == EMPTY) {
+          keys_[slot] = key;
+          values_[slot] = value;
+          states_[slot] = OCCUPIED;
+          break;
+        }
+
+        const K carried_key = keys_[slot];
+        const V carried_value = values_[slot];
+        keys_[slot] = key;
+        values_[slot] = value;
+        states_[slot] = OCCUPIED;
+
+        key = carried_key;
+        value = carried_value;
+        slot = int32_t(hash_key(key) & (capacity_ - 1));
+      }
+    }
+
+    used_ = size_;
+  }
+
+  int32_t find_slot(const K& key) const {
+    int32_t slot = int32_t(hash_key(key) & (capacity_ - 1));
+
+    for (int32_t probe = 0; probe < capacity_; probe++) {
+      if (states_[slot] == EMPTY) {
+        return NONE;
+      }
+
+      if (states_[slot] == OCCUPIED && keys_[slot] == key) {
+        return slot;
+      }
+
+      slot = (slot + 1) & (capacity_ - 1);
+    }
+
+    return NONE;
+  }
+
+  K* keys_ = nullptr;
+  V* values_ = nullptr;
+  uint8_t* states_ = nullptr;
+  int32_t capacity_ = 0;
+  int32_t size_ = 0;
+  int32_t used_ = 0; // Occupied plus tombstones
+};
+
+// Single producer, single consumer FIFO over arena memory. The capacity is rounded up to a power of two.
+// push() may run on one thread while pop(), front() and operator[] run on another, the write index is
+// published with release and read with acquire so the item is visible before its slot counts. clear()
+// and init() need both sides stopped.
+template <typename T> class RingBuffer final {
+  DISABLE_COPY_AND_MOVE(RingBuffer);
+public:
+  RingBuffer() = default;
+  ~RingBuffer() = default;
+
+  bool init(MemoryArena* arena, int32_t capacity) {
+    ASSERT(arena && capacity > 0);
+
+    int32_t rounded_capacity = 1;
+    while (rounded_capacity < capacity) {
+      rounded_capacity <<= 1;
+    }
+
+    items_ = arena_push<T>(arena, rounded_capacity, container_alignment<T>());
+    if (!items_) {
+      return false;
+    }
+
+    capacity_ = rounded_capacity;
+    clear();
+    return true;
+  }
+
+  // Producer side.
+  bool push(const T& item) {
+    const uint32_t write = write_.load(std::memory_order_relaxed);
+    if (write - read_.load(std::memory_order_acquire) == uint32_t(capacity_)) {
+      return false;
+    }
+
+    items_[write & (capacity_ - 1)] = item;
+    write_.store(write + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(T* item) {
+    const uint32_t read = read_.load(std::memory_order_relaxed);
+    if (read == write_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    *item = items_[read & (capacity_ - 1)];
+    read_.store(read + 1, std::memory_order_release);
+    return true;
+  }
+
+  T& front() {
+    ASSERT(!empty());
+    return items_[read_.load(std::memory_order_relaxed) & (capacity_ - 1)];
+  }
+
+  // Index 0 is the oldest element.
+  T& operator[](uint32_t index) {
+    ASSERT(index < size());
+    return items_[(read_.load(std::memory_order_relaxed) + index) & (capacity_ - 1)];
+  }
+
+  void clear() {
+    read_.store(0, std::memory_order_relaxed);
+    write_.store(0, std::memory_order_relaxed);
+  }
+
+  // Exact on either side for its own end, the other end may move on concurrently.
+  uint32_t size() const { return write_.load(std::memory_order_acquire) - read_.load(std::memory_order_acquire); }
+  int32_t capacity() const { return capacity_; }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() == uint32_t(capacity_); }
+
+private:
+  T* items_ = nullptr;
+  int32_t capacity_ = 0;
+  std::atomic<uint32_t> read_ = 0;
+  std::atomic<uint32_t> write_ = 0;
+};
+
+} //namespace
+} //namespace
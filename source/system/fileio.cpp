@@ -46,11 +46,14 @@ ByteBuffer FileIO::read_bytes(const char* path, size_t alloc_size_bytes) {
     return buffer;
   }
 
-  buffer.bytes = (uint8_t*)memory_arena_alloc(file_io_arena, alloc_size_bytes, sizeof(uint8_t));
-  if (buffer.bytes) {
-    buffer.size = alloc_size_bytes;
+  buffer.bytes = arena_push<uint8_t>(file_io_arena, alloc_size_bytes);
+  if (!buffer.bytes) {
+    fclose(file);
+    return buffer;
   }
 
+  buffer.size = alloc_size_bytes;
+
   size_t read_size = 0;
 
   do {
@@ -65,12 +68,31 @@ ByteBuffer FileIO::read_bytes(const char* path, size_t alloc_size_bytes) {
 
   fclose(file);
 
+  // Hand the unread tail of the buffer back to the arena.
+  memory_arena_restore(ArenaMarker{file_io_arena, size_t(buffer.bytes - file_io_arena->bytes) + read_size});
+
   buffer.size = read_size;
   return buffer;
 }
 
 size_t FileIO::write_bytes(const char* path, const ByteBuffer* buffer) {
-  return 0;
+  ASSERT(path);
+  ASSERT(buffer);
+
+  FILE* file = fopen(path, "wb");
+  if (!file || ferror(file)) {
+    log_error("Failed to open file [%s]", path);
+    return 0;
+  }
+
+  const size_t write_size = fwrite(buffer->bytes, sizeof(uint8_t), buffer->size, file);
+  fclose(file);
+
+  if (write_size != buffer->size) {
+    log_error("Failed to write file [%s]", path);
+  }
+
+  return write_size;
 }
 
 } //namespace	
@@ -0,0 +1,401 @@
+// memory.cpp
+#include "memory.h"
+#include "alloc_verifier.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MEMORY_CALLER_ADDRESS() _ReturnAddress()
+#else
+#define MEMORY_CALLER_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace Asteroids {
+namespace System {
+
+constexpr size_t MEMORY_COMMIT_GRANULE = KB(64);
+constexpr size_t MEMORY_HUGE_PAGE_SIZE = MB(2);
+
+// Keeps arena->bytes on a cache line so offsets and addresses share their alignment.
+constexpr size_t MEMORY_ARENA_HEADER_SIZE = align_up(sizeof(MemoryArena), MEMORY_ARENA_MAX_ALIGNMENT);
+
+constexpr size_t MAX_MEMORY_TRACE_SITES = 256;
+
+struct MemoryTraceSite {
+  const void* caller;
+  const MemoryArena* arena;
+  size_t alloc_count;
+  size_t alloc_size;
+};
+
+constexpr size_t MEMORY_DEFAULT_SCRATCH_ARENA_SIZE = MB(4);
+
+struct ScratchArenaSlot {
+  MemoryArena* arena = nullptr;
+  int frame = -1;
+
+  ~ScratchArenaSlot() {
+    if (arena) {
+      memory_arena_free(arena);
+    }
+  }
+};
+
+static MemoryPageMode page_mode = MEMORY_PAGES_DEFAULT;
+
+static SDL_SpinLock registry_lock = 0;
+static MemoryArena* arena_registry[MAX_MEMORY_ARENAS] = {};
+
+static size_t scratch_arena_size = MEMORY_DEFAULT_SCRATCH_ARENA_SIZE;
+static SDL_atomic_t scratch_frame = {};
+static SDL_atomic_t scratch_arena_count = {};
+static thread_local ScratchArenaSlot scratch_slot;
+
+static bool trace_enabled = false;
+static MemoryTraceSite trace_sites[MAX_MEMORY_TRACE_SITES] = {};
+static size_t trace_site_count = 0;
+static size_t trace_dropped_count = 0;
+
+static void register_arena(MemoryArena* arena) {
+  SDL_AtomicLock(&registry_lock);
+  for (size_t i = 0; i < MAX_MEMORY_ARENAS; i++) {
+    if (!arena_registry[i]) {
+      arena_registry[i] = arena;
+      SDL_AtomicUnlock(&registry_lock);
+      return;
+    }
+  }
+  SDL_AtomicUnlock(&registry_lock);
+
+  log_info("Memory arena registry is full, [%.8s] is not tracked", (const char*)arena->tag);
+}
+
+static void unregister_arena(MemoryArena* arena) {
+  SDL_AtomicLock(&registry_lock);
+  for (size_t i = 0; i < MAX_MEMORY_ARENAS; i++) {
+    if (arena_registry[i] == arena) {
+      arena_registry[i] = nullptr;
+    }
+  }
+
+  // Sites of a released arena would otherwise show up under whatever arena reuses the address.
+  for (size_t i = 0; i < trace_site_count; i++) {
+    if (trace_sites[i].arena == arena) {
+      trace_sites[i].arena = nullptr;
+    }
+  }
+  SDL_AtomicUnlock(&registry_lock);
+}
+
+static void trace_alloc(const MemoryArena* arena, size_t alloc_size, const void* caller) {
+  SDL_AtomicLock(&registry_lock);
+  for (size_t i = 0; i < trace_site_count; i++) {
+    if (trace_sites[i].caller == caller && trace_sites[i].arena == arena) {
+      trace_sites[i].alloc_count++;
+      trace_sites[i].alloc_size += alloc_size;
+      SDL_AtomicUnlock(&registry_lock);
+      return;
+    }
+  }
+
+  if (trace_site_count < MAX_MEMORY_TRACE_SITES) {
+    trace_sites[trace_site_count++] = MemoryTraceSite{caller, arena, 1, alloc_size};
+  } else {
+    trace_dropped_count++;
+  }
+  SDL_AtomicUnlock(&registry_lock);
+}
+
+static inline size_t commit_granule() {
+  return page_mode == MEMORY_PAGES_DEFAULT ? MEMORY_COMMIT_GRANULE : MEMORY_HUGE_PAGE_SIZE;
+}
+
+// Reservations are huge page sized so any part of them can be committed with huge pages later.
+static inline size_t reserve_size(const MemoryArena* arena) {
+  return align_up(arena->allocated_size + MEMORY_ARENA_HEADER_SIZE, MEMORY_HUGE_PAGE_SIZE);
+}
+
+// Keeps at least the header granule, decommit boundaries are huge page aligned so explicit huge page
+// mappings are never split.
+static void memory_arena_decommit(MemoryArena* arena, size_t used_size) {
+  const size_t keep_size = align_up(MEMORY_ARENA_HEADER_SIZE + used_size, MEMORY_HUGE_PAGE_SIZE);
+  if (keep_size >= arena->committed_size) {
+    return;
+  }
+
+  memory_decommit((uint8_t*)arena + keep_size, arena->committed_size - keep_size);
+  arena->committed_size = keep_size;
+}
+
+static bool memory_arena_commit(MemoryArena* arena, size_t used_size) {
+  const size_t required_size = MEMORY_ARENA_HEADER_SIZE + used_size;
+  if (required_size <= arena->committed_size) {
+    return true;
+  }
+
+  const size_t commit_end = min(align_up(required_size, commit_granule()), reserve_size(arena));
+
+  // An arena created before explicit huge pages were turned on has a small header commit. The rest of its
+  // first huge page takes normal pages so every huge page commit after it starts on a huge page boundary.
+  if (page_mode == MEMORY_PAGES_HUGE && arena->committed_size % MEMORY_HUGE_PAGE_SIZE != 0) {
+    const size_t boundary = min(align_up(arena->committed_size, MEMORY_HUGE_PAGE_SIZE), commit_end);
+    if (!memory_commit((uint8_t*)arena + arena->committed_size, boundary - arena->committed_size, MEMORY_PAGES_DEFAULT)) {
+      log_error("Failed to commit [%zu] bytes for memory arena [%.8s]", boundary, (const char*)arena->tag);
+      return false;
+    }
+
+    arena->committed_size = boundary;
+    if (boundary == commit_end) {
+      return true;
+    }
+  }
+
+  if (!memory_commit((uint8_t*)arena + arena->committed_size, commit_end - arena->committed_size, page_mode)) {
+    log_error("Failed to commit [%zu] bytes for memory arena [%.8s]", commit_end, (const char*)arena->tag);
+    return false;
+  }
+
+  arena->committed_size = commit_end;
+  return true;
+}
+
+void memory_set_page_mode(MemoryPageMode mode) {
+  page_mode = mode;
+}
+
+MemoryPageMode memory_page_mode() {
+  return page_mode;
+}
+
+MemoryArena* memory_arena_create(const char* tag, size_t size, uint32_t flags) {
+  ASSERT(tag);
+  ASSERT(size);
+
+  const size_t total_size = align_up(size + MEMORY_ARENA_HEADER_SIZE, MEMORY_HUGE_PAGE_SIZE);
+  uint8_t* memory = (uint8_t*)memory_reserve(total_size);
+  if (!memory) {
+    log_error("Failed to reserve [%zu] bytes for memory arena [%s]", total_size, tag);
+    return nullptr;
+  }
+
+  const size_t header_commit_size = min(commit_granule(), total_size);
+  if (!memory_commit(memory, header_commit_size, page_mode)) {
+    memory_release(memory, total_size);
+    return nullptr;
+  }
+
+  MemoryArena* arena = (MemoryArena*)memory;
+  memset(arena, 0, sizeof(MemoryArena));
+  arena->allocated_size = size;
+  arena->committed_size = header_commit_size;
+  arena->bytes = memory + MEMORY_ARENA_HEADER_SIZE;
+  arena->flags = flags;
+  memcpy(arena->tag, tag, System::min<size_t>(strlen(tag), 8));
+
+  register_arena(arena);
+  return arena;
+}
+
+void memory_arena_free(MemoryArena* arena) {
+  ASSERT(arena);
+  unregister_arena(arena);
+  memory_release(arena, reserve_size(arena));
+}
+
+static void* arena_alloc(MemoryArena* arena, size_t element_count, size_t element_size, size_t alignment, const void* caller) {
+  ASSERT(element_count > 0 && element_size > 0);
+  ASSERT(alignment > 0 && alignment <= MEMORY_ARENA_MAX_ALIGNMENT && (alignment & (alignment - 1)) == 0);
+
+  const size_t used_size = align_up(arena->used_size, alignment);
+  const size_t alloc_size = element_count * element_size;
+  ASSERT((used_size + alloc_size) < arena->allocated_size);
+  if ((used_size + alloc_size) > arena->allocated_size) {
+    log_error("Request allocation is too larged for the arena");
+    return nullptr;
+  }
+
+  if (!memory_arena_commit(arena, used_size + alloc_size)) {
+    return nullptr;
+  }
+
+  arena->used_size = used_size + alloc_size;
+  arena->peak_used_size = max(arena->peak_used_size, arena->used_size);
+  arena->alloc_count++;
+  arena->largest_alloc_size = max(arena->largest_alloc_size, alloc_size);
+
+  if (trace_enabled) {
+    trace_alloc(arena, alloc_size, caller);
+  }
+
+  if (!(arena->flags & MEMORY_ARENA_FRAME)) {
+    alloc_verifier_count_arena(alloc_size);
+  }
+
+  return arena->bytes + used_size;
+}
+
+void* memory_arena_alloc(MemoryArena* arena, size_t element_count, size_t element_size) {
+  return arena_alloc(arena, element_count, element_size, MEMORY_ARENA_DEFAULT_ALIGNMENT, MEMORY_CALLER_ADDRESS());
+}
+
+void* memory_arena_alloc_aligned(MemoryArena* arena, size_t element_count, size_t element_size, size_t alignment) {
+  return arena_alloc(arena, element_count, element_size, alignment, MEMORY_CALLER_ADDRESS());
+}
+
+void* memory_arena_alloc_zeroed(MemoryArena* arena, size_t element_count, size_t element_size) {
+  void* memory = arena_alloc(arena, element_count, element_size, MEMORY_ARENA_DEFAULT_ALIGNMENT, MEMORY_CALLER_ADDRESS());
+  if (memory) {
+    memset(memory, 0, element_count * element_size);
+  }
+
+  return memory;
+}
+
+void memory_arena_reset(MemoryArena* arena) {
+  if (arena->flags & MEMORY_ARENA_DECOMMIT_ON_RESET) {
+    // Decommitted pages come back zeroed, only what stays committed needs clearing.
+    memory_arena_decommit(arena, 0);
+    memset(arena->bytes, 0, min(arena->used_size, arena->committed_size - MEMORY_ARENA_HEADER_SIZE));
+  } else {
+    memset(arena->bytes, 0, arena->used_size);
+  }
+
+  arena->used_size = 0;
+}
+
+void memory_arena_clear(MemoryArena* arena) {
+  arena->used_size = 0;
+}
+
+void memory_arena_trim(MemoryArena* arena) {
+  ASSERT(arena);
+  memory_arena_decommit(arena, arena->used_size);
+}
+
+void memory_arena_log_usage(const MemoryArena* arena) {
+  ASSERT(arena);
+  log_info("Arena [%.8s] used: %zu committed: %zu reserved: %zu",
+    (const char*)arena->tag, arena->used_size, arena->committed_size, reserve_size(arena));
+}
+
+void memory_set_trace(bool enabled) {
+  trace_enabled = enabled;
+}
+
+void memory_set_scratch_arena_size(size_t size) {
+  ASSERT(size);
+  scratch_arena_size = size;
+}
+
+MemoryArena* memory_scratch_arena() {
+  if (!scratch_slot.arena) {
+    char tag[9] = {};
+    snprintf(tag, sizeof(tag), "SCRT%04u", uint32_t(SDL_AtomicAdd(&scratch_arena_count, 1)) % 10000u);
+
+    scratch_slot.arena = memory_arena_create(tag, scratch_arena_size, MEMORY_ARENA_FRAME);
+    if (!scratch_slot.arena) {
+      return nullptr;
+    }
+  }
+
+  const int frame = SDL_AtomicGet(&scratch_frame);
+  if (scratch_slot.frame != frame) {
+    memory_arena_clear(scratch_slot.arena);
+    scratch_slot.frame = frame;
+  }
+
+  return scratch_slot.arena;
+}
+
+void memory_scratch_begin_frame() {
+  SDL_AtomicAdd(&scratch_frame, 1);
+}
+
+void memory_arena_dump_stats() {
+  SDL_AtomicLock(&registry_lock);
+  log_info("%-8s %12s %12s %12s %12s %10s %12s",
+    "Arena", "Reserved", "Committed", "Used", "Peak", "Allocs", "Largest");
+
+  for (size_t i = 0; i < MAX_MEMORY_ARENAS; i++) {
+    const MemoryArena* arena = arena_registry[i];
+    if (!arena) {
+      continue;
+    }
+
+    log_info("%-8.8s %12zu %12zu %12zu %12zu %10zu %12zu",
+      (const char*)arena->tag, reserve_size(arena), arena->committed_size, arena->used_size,
+      arena->peak_used_size, arena->alloc_count, arena->largest_alloc_size);
+  }
+
+  if (!trace_enabled) {
+    SDL_AtomicUnlock(&registry_lock);
+    return;
+  }
+
+  log_info("%-8s %18s %10s %12s", "Arena", "Call site", "Allocs", "Bytes");
+  for (size_t i = 0; i < trace_site_count; i++) {
+    const MemoryTraceSite* site = &trace_sites[i];
+    log_info("%-8.8s %18p %10zu %12zu",
+      site->arena ? (const char*)site->arena->tag : "(freed)", site->caller, site->alloc_count, site->alloc_size);
+  }
+
+  if (trace_dropped_count > 0) {
+    log_info("%zu allocations from untracked call sites", trace_dropped_count);
+  }
+  SDL_AtomicUnlock(&registry_lock);
+}
+
+bool frame_arena_create(FrameArena* frame_arena, const char* tag, size_t size, int32_t buffer_count) {
+  ASSERT(frame_arena && tag);
+  ASSERT(buffer_count >= 1 && buffer_count <= MAX_FRAME_ARENA_BUFFERS);
+
+  memset(frame_arena, 0, sizeof(FrameArena));
+
+  for (int32_t i = 0; i < buffer_count; i++) {
+    char buffer_tag[9] = {};
+    snprintf(buffer_tag, sizeof(buffer_tag), "%.7s%d", tag, i);
+
+    frame_arena->buffers[i] = memory_arena_create(buffer_tag, size, MEMORY_ARENA_FRAME);
+    if (!frame_arena->buffers[i]) {
+      frame_arena_free(frame_arena);
+      return false;
+    }
+
+    frame_arena->buffer_count++;
+  }
+
+  return true;
+}
+
+void frame_arena_free(FrameArena* frame_arena) {
+  ASSERT(frame_arena);
+
+  for (int32_t i = 0; i < frame_arena->buffer_count; i++) {
+    memory_arena_free(frame_arena->buffers[i]);
+    frame_arena->buffers[i] = nullptr;
+  }
+
+  frame_arena->buffer_count = 0;
+}
+
+MemoryArena* frame_arena_next(FrameArena* frame_arena) {
+  ASSERT(frame_arena && frame_arena->buffer_count > 0);
+
+  frame_arena->current = (frame_arena->current + 1) % frame_arena->buffer_count;
+  MemoryArena* arena = frame_arena->buffers[frame_arena->current];
+  memory_arena_clear(arena);
+  return arena;
+}
+
+MemoryArena* frame_arena_current(const FrameArena* frame_arena) {
+  ASSERT(frame_arena && frame_arena->buffer_count > 0);
+  return frame_arena->buffers[frame_arena->current];
+}
+
+MemoryArena* frame_arena_previous(const FrameArena* frame_arena) {
+  ASSERT(frame_arena && frame_arena->buffer_count > 0);
+  const int32_t previous = (frame_arena->current + frame_arena->buffer_count - 1) % frame_arena->buffer_count;
+  return frame_arena->buffers[previous];
+}
+
+} //namespace
+} //namespace
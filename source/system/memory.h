@@ -10,17 +10,119 @@ constexpr size_t KB(size_t bytes) { return bytes * 1024LL; }
 constexpr size_t MB(size_t bytes) { return bytes * 1024LL * 1024LL; }
 constexpr size_t GB(size_t bytes) { return bytes * 1024LL * 1024LL * 1024LL; }
 
+constexpr size_t align_up(size_t size, size_t alignment) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+enum MemoryPageMode {
+  MEMORY_PAGES_DEFAULT = 0,
+  MEMORY_PAGES_TRANSPARENT_HUGE = 1, // Hint the kernel to back commits with huge pages
+  MEMORY_PAGES_HUGE = 2, // Explicit huge pages, falls back to transparent when none are reserved
+};
+
+constexpr size_t MEMORY_ARENA_DEFAULT_ALIGNMENT = 16;
+constexpr size_t MEMORY_ARENA_MAX_ALIGNMENT = 64;
+
+constexpr size_t MAX_MEMORY_ARENAS = 32;
+
+enum MemoryArenaFlags {
+  MEMORY_ARENA_DECOMMIT_ON_RESET = 1, // Return committed pages to the OS when the arena is reset
+  MEMORY_ARENA_FRAME = 2, // Frame and scratch memory, allowed to be allocated from every frame
+};
+
+// Arena memory is reserved up front and committed as used_size grows, so reserving far more than
+// the expected peak is cheap. allocated_size is the usable reserved size, committed_size includes the arena header.
 struct MemoryArena {
   int8_t tag[8];
   size_t allocated_size;
   size_t used_size;
+  size_t committed_size;
   uint8_t* bytes;
+  uint32_t flags;
+
+  // Telemetry, kept across resets
+  size_t peak_used_size;
+  size_t alloc_count;
+  size_t largest_alloc_size;
 };
 
-MemoryArena* memory_arena_create(const char* tag, size_t size);
+MemoryArena* memory_arena_create(const char* tag, size_t size, uint32_t flags = 0);
 void memory_arena_free(MemoryArena* arena);
 void* memory_arena_alloc(MemoryArena* arena, size_t element_count, size_t element_size);
+void* memory_arena_alloc_zeroed(MemoryArena* arena, size_t element_count, size_t element_size);
+void* memory_arena_alloc_aligned(MemoryArena* arena, size_t element_count, size_t element_size, size_t alignment);
 void memory_arena_reset(MemoryArena* arena);
+void memory_arena_clear(MemoryArena* arena); // O(1), leaves the old contents in place
+void memory_arena_trim(MemoryArena* arena); // Decommits pages past used_size
+void memory_arena_log_usage(const MemoryArena* arena);
+
+// Every live arena is registered on create, the dump logs one row per arena.
+// Tracing additionally aggregates allocations by call site, resolve the addresses with addr2line.
+void memory_arena_dump_stats();
+void memory_set_trace(bool enabled);
+
+template <typename T> T* arena_push(MemoryArena* arena, size_t count, size_t alignment = alignof(T)) {
+  return (T*)memory_arena_alloc_aligned(arena, count, sizeof(T), alignment);
+}
+
+struct ArenaMarker {
+  MemoryArena* arena;
+  size_t used_size;
+};
+
+inline ArenaMarker memory_arena_marker(MemoryArena* arena) {
+  return ArenaMarker{arena, arena->used_size};
+}
+
+// Gives back everything allocated after the marker was taken, the contents are not cleared.
+inline void memory_arena_restore(const ArenaMarker& marker) {
+  ASSERT(marker.arena && marker.used_size <= marker.arena->used_size);
+  marker.arena->used_size = marker.used_size;
+}
+
+// Scratch allocations made while the scope is alive are released when it ends.
+class ArenaScope final {
+  DISABLE_COPY_AND_MOVE(ArenaScope);
+public:
+  explicit ArenaScope(MemoryArena* arena) : marker_(memory_arena_marker(arena)) {}
+  ~ArenaScope() { memory_arena_restore(marker_); }
+
+private:
+  ArenaMarker marker_;
+};
+
+constexpr int32_t MAX_FRAME_ARENA_BUFFERS = 3;
+
+// Per-frame scratch memory. Advancing to the next frame clears the oldest buffer without zeroing it,
+// the previous frame's buffer stays readable until it comes around again.
+struct FrameArena {
+  MemoryArena* buffers[MAX_FRAME_ARENA_BUFFERS];
+  int32_t buffer_count;
+  int32_t current;
+};
+
+bool frame_arena_create(FrameArena* frame_arena, const char* tag, size_t size, int32_t buffer_count);
+void frame_arena_free(FrameArena* frame_arena);
+MemoryArena* frame_arena_next(FrameArena* frame_arena);
+MemoryArena* frame_arena_current(const FrameArena* frame_arena);
+MemoryArena* frame_arena_previous(const FrameArena* frame_arena);
+
+// Each thread gets its own scratch arena on first use, nothing is shared so no locking is needed.
+// memory_scratch_begin_frame() marks a frame boundary, every scratch arena is cleared the next time
+// its thread asks for it. Scratch memory must not be held across frames.
+void memory_set_scratch_arena_size(size_t size);
+MemoryArena* memory_scratch_arena();
+void memory_scratch_begin_frame();
+
+// Applies to commits made after the call, arenas created earlier pick it up as they grow.
+void memory_set_page_mode(MemoryPageMode mode);
+MemoryPageMode memory_page_mode();
+
+// Platform virtual memory, implemented in memory_win32.cpp / memory_posix.cpp
+void* memory_reserve(size_t size);
+bool memory_commit(void* address, size_t size, MemoryPageMode mode);
+void memory_decommit(void* address, size_t size);
+void memory_release(void* address, size_t size);
 
 } //namespace
 } //namespace
@@ -0,0 +1,103 @@
+// memory_posix.cpp
+#include "memory.h"
+
+#include <sys/mman.h>
+
+namespace Asteroids {
+namespace System {
+
+constexpr size_t MEMORY_RESERVE_ALIGNMENT = MB(2);
+
+void* memory_reserve(size_t size) {
+  ASSERT(size);
+
+  // Over-reserve and trim so the range starts on a huge page boundary.
+  const size_t mapped_size = size + MEMORY_RESERVE_ALIGNMENT;
+  void* memory = mmap(nullptr, mapped_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+
+  uint8_t* mapped_start = (uint8_t*)memory;
+  uint8_t* start = (uint8_t*)align_up((size_t)mapped_start, MEMORY_RESERVE_ALIGNMENT);
+  uint8_t* end = start + size;
+
+  if (start > mapped_start) {
+    munmap(mapped_start, start - mapped_start);
+  }
+
+  if (mapped_start + mapped_size > end) {
+    munmap(end, (mapped_start + mapped_size) - end);
+  }
+
+  return start;
+}
+
+static inline void advise_huge_pages(void* address, size_t size, MemoryPageMode mode) {
+#ifdef MADV_HUGEPAGE
+  if (mode != MEMORY_PAGES_DEFAULT) {
+    madvise(address, size, MADV_HUGEPAGE);
+  }
+#endif
+}
+
+bool memory_commit(void* address, size_t size, MemoryPageMode mode) {
+  ASSERT(address && size);
+
+#ifdef MAP_HUGETLB
+  if (mode == MEMORY_PAGES_HUGE
+    && ((size_t)address % MEMORY_RESERVE_ALIGNMENT) == 0
+    && (size % MEMORY_RESERVE_ALIGNMENT) == 0) {
+
+    void* memory = mmap(address, size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+      return true;
+    }
+
+    static bool warned = false;
+    if (!warned) {
+      log_info("Explicit huge pages are not available, using transparent huge pages");
+      warned = true;
+    }
+
+    // A failed MAP_FIXED may have dropped the reservation, map the range again with normal pages.
+    memory = mmap(address, size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+      return false;
+    }
+
+    advise_huge_pages(address, size, mode);
+    return true;
+  }
+#endif
+
+  if (mprotect(address, size, PROT_READ | PROT_WRITE) != 0) {
+    return false;
+  }
+
+  advise_huge_pages(address, size, mode);
+  return true;
+}
+
+void memory_decommit(void* address, size_t size) {
+  ASSERT(address && size);
+
+  // Mapping fresh PROT_NONE pages over the range drops the old ones, huge pages included.
+  void* memory = mmap(address, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+  if (memory == MAP_FAILED) {
+    log_error("Failed to decommit memory");
+  }
+}
+
+void memory_release(void* address, size_t size) {
+  ASSERT(address);
+
+  if (munmap(address, size) != 0) {
+    log_error("Failed to free memory arena");
+  }
+}
+
+} //namespace
+} //namespace
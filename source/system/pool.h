@@ -0,0 +1,138 @@
+// pool.h
+#pragma once
+
+#include "system.h"
+#include "memory.h"
+
+namespace Asteroids {
+namespace System {
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Fixed capacity pool of T carved out of an arena. Free slots form an intrusive list of slot indices,
+// so alloc and free are O(1) and slot indices stay stable for the lifetime of the object.
+template <typename T> class Pool final {
+  DISABLE_COPY_AND_MOVE(Pool);
+public:
+  static constexpr size_t SLOT_ALIGNMENT = alignof(T) > alignof(int32_t) ? alignof(T) : alignof(int32_t);
+  static constexpr size_t SLOT_SIZE = align_up(sizeof(T) > sizeof(int32_t) ? sizeof(T) : sizeof(int32_t), SLOT_ALIGNMENT);
+  static constexpr int32_t NONE = -1; // End of the free list, free slots start with the next free index
+
+  Pool() = default;
+  ~Pool() = default;
+
+  bool init(MemoryArena* arena, int32_t capacity) {
+    ASSERT(arena && capacity > 0);
+
+    slots_ = arena_push<uint8_t>(arena, capacity * SLOT_SIZE, CACHE_LINE_SIZE);
+    if (!slots_) {
+      return false;
+    }
+
+    capacity_ = capacity;
+    return true;
+  }
+
+  T* alloc() {
+    int32_t index = free_head_;
+
+    if (index != NONE) {
+      free_head_ = *(int32_t*)slot(index);
+    } else if (slot_count_ < capacity_) {
+      index = slot_count_++;
+    } else {
+      return nullptr;
+    }
+
+    live_count_++;
+    peak_count_ = max(peak_count_, live_count_);
+    alloc_count_++;
+
+    return (T*)memset(slot(index), 0, SLOT_SIZE);
+  }
+
+  // Allocates up to count slots, free ones first and then untouched ones as a single range, and writes
+  // their indices to out in that order. Returns how many it got. Slots are not cleared, the caller writes
+  // them whole.
+  int32_t alloc_batch(int32_t count, int32_t* out) {
+    ASSERT(count >= 0 && out);
+
+    int32_t allocated = 0;
+    while (allocated < count && free_head_ != NONE) {
+      out[allocated++] = free_head_;
+      free_head_ = *(int32_t*)slot(free_head_);
+    }
+
+    const int32_t fresh = min(count - allocated, capacity_ - slot_count_);
+    for (int32_t i = 0; i < fresh; i++) {
+      out[allocated++] = slot_count_ + i;
+    }
+
+    slot_count_ += fresh;
+    live_count_ += allocated;
+    peak_count_ = max(peak_count_, live_count_);
+    alloc_count_ += size_t(allocated);
+    return allocated;
+  }
+
+  void free(T* item) {
+    const int32_t index = index_of(item);
+    ASSERT(index >= 0 && index < slot_count_);
+
+    *(int32_t*)slot(index) = free_head_;
+    free_head_ = index;
+    live_count_--;
+  }
+
+  T* at(int32_t index) const {
+    ASSERT(index >= 0 && index < slot_count_);
+    return (T*)slot(index);
+  }
+
+  // Only indexable as T[] when SLOT_SIZE == sizeof(T), free slots hold the free list link.
+  T* items() const {
+    return (T*)slots_;
+  }
+
+  int32_t index_of(const T* item) const {
+    return int32_t(((const uint8_t*)item - slots_) / SLOT_SIZE);
+  }
+
+  int32_t capacity() const { return capacity_; }
+  int32_t slot_count() const { return slot_count_; } // Slots ever handed out, live or free
+  int32_t live_count() const { return live_count_; }
+  int32_t peak_count() const { return peak_count_; }
+  size_t alloc_count() const { return alloc_count_; }
+  int32_t free_head() const { return free_head_; }
+
+  // Puts the bookkeeping back to a saved slot_count(), live_count() and free_head(), for callers that
+  // restore the slot bytes themselves.
+  void restore(int32_t slot_count, int32_t live_count, int32_t free_head) {
+    ASSERT(slot_count >= 0 && slot_count <= capacity_ && live_count <= slot_count);
+    slot_count_ = slot_count;
+    live_count_ = live_count;
+    free_head_ = free_head;
+    peak_count_ = max(peak_count_, live_count_);
+  }
+
+  void log_stats(const char* name) const {
+    log_info("Pool [%s] live: %d peak: %d slots: %d capacity: %d allocs: %zu",
+      name, live_count_, peak_count_, slot_count_, capacity_, alloc_count_);
+  }
+
+private:
+  uint8_t* slot(int32_t index) const {
+    return slots_ + index * SLOT_SIZE;
+  }
+
+  uint8_t* slots_ = nullptr;
+  int32_t capacity_ = 0;
+  int32_t slot_count_ = 0;
+  int32_t free_head_ = NONE;
+  int32_t live_count_ = 0;
+  int32_t peak_count_ = 0;
+  size_t alloc_count_ = 0;
+};
+
+} //namespace
+} //namespace
@@ -0,0 +1,129 @@
+// profiler.cpp
+#include "profiler.h"
+#include "radix_sort.h"
+
+namespace Asteroids {
+namespace System {
+
+bool Profiler::init(MemoryArena* arena, int32_t window) {
+  ASSERT(arena && window > 0);
+
+  arena_ = arena;
+  window_ = window;
+  system_count_ = 0;
+  return true;
+}
+
+int32_t Profiler::find_system(const char* name) const {
+  for (int32_t i = 0; i < system_count_; i++) {
+    if (strcmp(systems_[i].name, name) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+int32_t Profiler::register_system(const char* name) {
+  ASSERT(arena_ && name);
+
+  const int32_t existing = find_system(name);
+  if (existing >= 0) {
+    return existing;
+  }
+
+  if (system_count_ == MAX_PROFILER_SYSTEMS) {
+    log_error("Profiler: no room to register [%s]", name);
+    return -1;
+  }
+
+  SystemSamples* system = &systems_[system_count_];
+  system->elapsed_ns = arena_push<uint32_t>(arena_, window_);
+  system->entities = arena_push<int32_t>(arena_, window_);
+  if (!system->elapsed_ns || !system->entities) {
+    return -1;
+  }
+
+  system->name = name;
+  system->sample_count = 0;
+  return system_count_++;
+}
+
+void Profiler::record(int32_t system_id, uint64_t elapsed_ns, int32_t entity_count) {
+  if (system_id < 0) {
+    return;
+  }
+
+  ASSERT(system_id < system_count_);
+  SystemSamples* system = &systems_[system_id];
+
+  const int32_t slot = int32_t(system->sample_count % uint64_t(window_));
+  system->elapsed_ns[slot] = uint32_t(min(elapsed_ns, uint64_t(UINT32_MAX)));
+  system->entities[slot] = entity_count;
+  system->sample_count++;
+}
+
+bool Profiler::stats(int32_t system_id, ProfilerStats* out, MemoryArena* scratch_arena) const {
+  ASSERT(out && scratch_arena);
+  if (system_id < 0 || system_id >= system_count_) {
+    return false;
+  }
+
+  const SystemSamples* system = &systems_[system_id];
+
+  *out = {};
+  out->name = system->name;
+  out->sample_count = system->sample_count;
+
+  const int32_t count = int32_t(min(system->sample_count, uint64_t(window_)));
+  if (count == 0) {
+    return true;
+  }
+
+  const int32_t last = int32_t((system->sample_count - 1) % uint64_t(window_));
+  out->last_ns = system->elapsed_ns[last];
+  out->last_entities = system->entities[last];
+
+  ArenaScope scratch_scope(scratch_arena);
+  int32_t* order = arena_push<int32_t>(scratch_arena, count);
+  if (!order || !radix_sort_indices(system->elapsed_ns, count, order, scratch_arena)) {
+    return false;
+  }
+
+  auto percentile = [system, order, count](int32_t percent) {
+    return system->elapsed_ns[order[(count - 1) * percent / 100]];
+  };
+
+  out->p50_ns = percentile(50);
+  out->p95_ns = percentile(95);
+  out->p99_ns = percentile(99);
+  out->max_ns = system->elapsed_ns[order[count - 1]];
+
+  uint64_t total_ns = 0;
+  int64_t total_entities = 0;
+  for (int32_t i = 0; i < count; i++) {
+    total_ns += system->elapsed_ns[i];
+    total_entities += system->entities[i];
+  }
+
+  out->mean_entities = double(total_entities) / count;
+  out->ns_per_entity = total_entities > 0 ? double(total_ns) / double(total_entities) : 0.0;
+  return true;
+}
+
+void Profiler::dump(MemoryArena* scratch_arena) const {
+  log_info("%-16s %9s %9s %9s %9s %9s %11s", "System", "Entities", "Last ms", "p50 ms", "p95 ms", "p99 ms", "ns/entity");
+
+  for (int32_t i = 0; i < system_count_; i++) {
+    ProfilerStats s = {};
+    if (!stats(i, &s, scratch_arena) || s.sample_count == 0) {
+      continue;
+    }
+
+    log_info("%-16s %9d %9.3lf %9.3lf %9.3lf %9.3lf %11.1lf", s.name, s.last_entities,
+      s.last_ns / 1000000.0, s.p50_ns / 1000000.0, s.p95_ns / 1000000.0, s.p99_ns / 1000000.0, s.ns_per_entity);
+  }
+}
+
+} //namespace
+} //namespace
@@ -0,0 +1,89 @@
+// profiler.h
+#pragma once
+
+#include "system.h"
+#include "memory.h"
+
+namespace Asteroids {
+namespace System {
+
+constexpr int32_t MAX_PROFILER_SYSTEMS = 32;
+
+// Rolling statistics of one system over the last window samples.
+struct ProfilerStats {
+  const char* name;
+  uint64_t sample_count; // Since init, the percentiles cover the last min(sample_count, window) of them
+  uint32_t last_ns;
+  int32_t last_entities;
+  uint32_t p50_ns;
+  uint32_t p95_ns;
+  uint32_t p99_ns;
+  uint32_t max_ns;
+  double mean_entities;
+  double ns_per_entity; // Window time over window entities, 0 when nothing was processed
+};
+
+// Per system frame timings. Systems register once by name, then record one sample per run with the number
+// of entities they processed. Samples are kept in a ring per system, percentiles are computed on query
+// so recording stays a few stores. Single threaded, samples above ~4.29 s are clamped.
+class Profiler final {
+  DISABLE_COPY_AND_MOVE(Profiler);
+public:
+  Profiler() = default;
+  ~Profiler() = default;
+
+  bool init(MemoryArena* arena, int32_t window);
+
+  // Returns the id of an already registered name, -1 when MAX_PROFILER_SYSTEMS are registered.
+  // name must outlive the profiler, string literals are expected.
+  int32_t register_system(const char* name);
+  int32_t find_system(const char* name) const;
+
+  void record(int32_t system_id, uint64_t elapsed_ns, int32_t entity_count);
+
+  // Temporaries come from scratch_arena.
+  bool stats(int32_t system_id, ProfilerStats* out, MemoryArena* scratch_arena) const;
+  void dump(MemoryArena* scratch_arena) const;
+
+  int32_t system_count() const { return system_count_; }
+
+  static uint64_t now_ns() {
+    return uint64_t(double(SDL_GetPerformanceCounter()) * 1000000000.0 / double(SDL_GetPerformanceFrequency()));
+  }
+
+private:
+  struct SystemSamples {
+    const char* name;
+    uint32_t* elapsed_ns;
+    int32_t* entities;
+    uint64_t sample_count;
+  };
+
+  MemoryArena* arena_ = nullptr;
+  int32_t window_ = 0;
+  SystemSamples systems_[MAX_PROFILER_SYSTEMS] = {};
+  int32_t system_count_ = 0;
+};
+
+// Records the time between construction and destruction as one sample of system_id.
+class ProfileScope final {
+  DISABLE_COPY_AND_MOVE(ProfileScope);
+public:
+  ProfileScope(Profiler* profiler, int32_t system_id)
+    : profiler_(profiler), system_id_(system_id), start_ns_(Profiler::now_ns()) {}
+
+  ~ProfileScope() {
+    profiler_->record(system_id_, Profiler::now_ns() - start_ns_, entity_count_);
+  }
+
+  void set_entity_count(int32_t entity_count) { entity_count_ = entity_count; }
+
+private:
+  Profiler* profiler_;
+  int32_t system_id_;
+  uint64_t start_ns_;
+  int32_t entity_count_ = 0;
+};
+
+} //namespace
+} //namespace
@@ -0,0 +1,75 @@
+// radix_sort.cpp
+#include "radix_sort.h"
+
+namespace Asteroids {
+namespace System {
+
+constexpr int32_t RADIX_BITS = 8;
+constexpr int32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+constexpr int32_t RADIX_PASSES = 32 / RADIX_BITS;
+
+bool radix_sort_indices(const uint32_t* keys, int32_t count, int32_t* sorted_indices, MemoryArena* scratch_arena) {
+  ASSERT(keys && sorted_indices && scratch_arena);
+  if (count <= 0) {
+    return true;
+  }
+
+  ArenaScope scratch_scope(scratch_arena);
+
+  int32_t* swap_indices = arena_push<int32_t>(scratch_arena, count);
+  int32_t* histograms = arena_push<int32_t>(scratch_arena, RADIX_PASSES * RADIX_BUCKETS);
+  if (!swap_indices || !histograms) {
+    log_error("Radix sort of %d keys does not fit the scratch arena", count);
+    return false;
+  }
+
+  // One read of the keys builds the histograms of every pass.
+  memset(histograms, 0, RADIX_PASSES * RADIX_BUCKETS * sizeof(int32_t));
+  for (int32_t i = 0; i < count; i++) {
+    const uint32_t key = keys[i];
+    for (int32_t pass = 0; pass < RADIX_PASSES; pass++) {
+      histograms[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+    }
+  }
+
+  for (int32_t i = 0; i < count; i++) {
+    sorted_indices[i] = i;
+  }
+
+  int32_t* from = sorted_indices;
+  int32_t* to = swap_indices;
+
+  for (int32_t pass = 0; pass < RADIX_PASSES; pass++) {
+    int32_t* histogram = &histograms[pass * RADIX_BUCKETS];
+    const int32_t shift = pass * RADIX_BITS;
+
+    if (histogram[(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count) {
+      continue;
+    }
+
+    int32_t offset = 0;
+    for (int32_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+      const int32_t bucket_count = histogram[bucket];
+      histogram[bucket] = offset;
+      offset += bucket_count;
+    }
+
+    for (int32_t i = 0; i < count; i++) {
+      const int32_t index = from[i];
+      to[histogram[(keys[index] >> shift) & (RADIX_BUCKETS - 1)]++] = index;
+    }
+
+    int32_t* swap = from;
+    from = to;
+    to = swap;
+  }
+
+  if (from != sorted_indices) {
+    memcpy(sorted_indices, from, count * sizeof(int32_t));
+  }
+
+  return true;
+}
+
+} //namespace
+} //namespace
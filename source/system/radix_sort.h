@@ -0,0 +1,16 @@
+// radix_sort.h
+#pragma once
+
+#include "system.h"
+#include "memory.h"
+
+namespace Asteroids {
+namespace System {
+
+// Stable LSD radix sort of 32 bit keys, 8 bits per pass, passes where every key shares the digit are
+// skipped. Writes the sorted order as indices into keys, temporaries come from scratch_arena and are
+// released before returning. Returns false when the scratch arena is too small.
+bool radix_sort_indices(const uint32_t* keys, int32_t count, int32_t* sorted_indices, MemoryArena* scratch_arena);
+
+} //namespace
+} //namespace
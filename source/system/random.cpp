@@ -7,14 +7,20 @@ namespace System {
 
 Random::Random() {
 #ifdef RELEASE
-  srand(time(nullptr));
-#else
-  srand(1137);
+  state_ = uint32_t(time(nullptr)) | 1;
 #endif
 }
 
+uint32_t Random::next() {
+  state_ ^= state_ << 13;
+  state_ ^= state_ >> 17;
+  state_ ^= state_ << 5;
+  return state_;
+}
+
 float Random::random_float(float low, float high) {
-  return low + rand() / (float(RAND_MAX) / (high - low));
+  // Top 24 bits, exactly representable in a float.
+  return low + float(next() >> 8) * (1.0F / 16777216.0F) * (high - low);
 }
 
 } //namespace
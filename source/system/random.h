@@ -13,6 +13,12 @@ public:
   ~Random() = default;
 
   float random_float(float low, float high);
+
+private:
+  // xorshift32, each generator has its own sequence and never touches the C library's rand() state.
+  uint32_t next();
+
+  uint32_t state_ = 1137;
 };
 
 } //namespace
@@ -0,0 +1,111 @@
+// timing_wheel.cpp
+#include "timing_wheel.h"
+
+namespace Asteroids {
+namespace System {
+
+bool TimingWheel::init(MemoryArena* arena, int32_t max_timers) {
+  ASSERT(arena && max_timers > 0);
+
+  nodes_ = arena_push<Node>(arena, max_timers);
+  if (!nodes_) {
+    return false;
+  }
+
+  max_timers_ = max_timers;
+  clear();
+  return true;
+}
+
+void TimingWheel::clear() {
+  for (int32_t i = 0; i < max_timers_; i++) {
+    nodes_[i].slot = NONE;
+  }
+
+  for (int32_t& slot : slots_) {
+    slot = NONE;
+  }
+
+  pending_count_ = 0;
+  now_ = 0;
+}
+
+void TimingWheel::schedule(int32_t timer_id, uint64_t expires_tick) {
+  ASSERT(timer_id >= 0 && timer_id < max_timers_);
+
+  if (nodes_[timer_id].slot != NONE) {
+    unlink(timer_id);
+  }
+
+  nodes_[timer_id].expires = expires_tick > now_ ? expires_tick : now_ + 1;
+  link(timer_id);
+}
+
+void TimingWheel::cancel(int32_t timer_id) {
+  ASSERT(timer_id >= 0 && timer_id < max_timers_);
+
+  if (nodes_[timer_id].slot != NONE) {
+    unlink(timer_id);
+  }
+}
+
+void TimingWheel::link(int32_t timer_id) {
+  Node* node = &nodes_[timer_id];
+
+  if (node->expires - now_ > TIMING_WHEEL_MAX_DELTA) {
+    node->expires = now_ + TIMING_WHEEL_MAX_DELTA;
+  }
+
+  const uint64_t delta = node->expires - now_;
+
+  int32_t level = 0;
+  while (level < TIMING_WHEEL_LEVELS - 1 && delta >= (uint64_t(1) << ((level + 1) * TIMING_WHEEL_SLOT_BITS))) {
+    level++;
+  }
+
+  const int32_t slot = level * TIMING_WHEEL_SLOTS
+    + int32_t((node->expires >> (level * TIMING_WHEEL_SLOT_BITS)) & (TIMING_WHEEL_SLOTS - 1));
+
+  node->slot = slot;
+  node->prev = NONE;
+  node->next = slots_[slot];
+  if (node->next != NONE) {
+    nodes_[node->next].prev = timer_id;
+  }
+
+  slots_[slot] = timer_id;
+  pending_count_++;
+}
+
+void TimingWheel::unlink(int32_t timer_id) {
+  Node* node = &nodes_[timer_id];
+  ASSERT(node->slot != NONE);
+
+  if (node->prev != NONE) {
+    nodes_[node->prev].next = node->next;
+  } else {
+    slots_[node->slot] = node->next;
+  }
+
+  if (node->next != NONE) {
+    nodes_[node->next].prev = node->prev;
+  }
+
+  node->slot = NONE;
+  pending_count_--;
+}
+
+void TimingWheel::cascade(int32_t slot) {
+  int32_t timer_id = slots_[slot];
+  slots_[slot] = NONE;
+
+  while (timer_id != NONE) {
+    const int32_t next = nodes_[timer_id].next;
+    pending_count_--;
+    link(timer_id);
+    timer_id = next;
+  }
+}
+
+} //namespace
+} //namespace
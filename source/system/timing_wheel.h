@@ -0,0 +1,93 @@
+// timing_wheel.h
+#pragma once
+
+#include "system.h"
+#include "memory.h"
+
+namespace Asteroids {
+namespace System {
+
+constexpr int32_t TIMING_WHEEL_LEVELS = 4;
+constexpr int32_t TIMING_WHEEL_SLOT_BITS = 6;
+constexpr int32_t TIMING_WHEEL_SLOTS = 1 << TIMING_WHEEL_SLOT_BITS;
+constexpr uint64_t TIMING_WHEEL_MAX_DELTA = (uint64_t(1) << (TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOT_BITS)) - 1;
+
+// Hierarchical timing wheel over integer ticks. Level 0 has one slot per tick, every level above covers
+// 64 times the range of the one below and is cascaded down when the lower level wraps. Advancing costs
+// O(ticks + expiring timers), nothing is scanned. Timer ids are indices below max_timers and own their
+// list node, so scheduling an id that is pending moves it and cancel is O(1).
+// Deltas above TIMING_WHEEL_MAX_DELTA ticks are clamped.
+class TimingWheel final {
+  DISABLE_COPY_AND_MOVE(TimingWheel);
+public:
+  TimingWheel() = default;
+  ~TimingWheel() = default;
+
+  bool init(MemoryArena* arena, int32_t max_timers);
+
+  // Expiry ticks at or before now() fire on the next tick.
+  void schedule(int32_t timer_id, uint64_t expires_tick);
+  void cancel(int32_t timer_id);
+
+  // Cancels every timer and restarts at tick 0.
+  void clear();
+
+  uint64_t expires(int32_t timer_id) const {
+    ASSERT(scheduled(timer_id));
+    return nodes_[timer_id].expires;
+  }
+
+  bool scheduled(int32_t timer_id) const {
+    ASSERT(timer_id >= 0 && timer_id < max_timers_);
+    return nodes_[timer_id].slot != NONE;
+  }
+
+  uint64_t now() const { return now_; }
+  int32_t pending_count() const { return pending_count_; }
+
+  // Calls on_expired(timer_id) for every timer due up to and including to_tick. The callback may schedule
+  // or cancel timers, including the one that expired.
+  template <typename F> void advance(uint64_t to_tick, F&& on_expired) {
+    while (now_ < to_tick) {
+      now_++;
+
+      // Highest level first, so timers cascading through several levels land in the right slot.
+      for (int32_t level = TIMING_WHEEL_LEVELS - 1; level > 0; level--) {
+        const uint64_t level_mask = (uint64_t(1) << (level * TIMING_WHEEL_SLOT_BITS)) - 1;
+        if ((now_ & level_mask) == 0) {
+          cascade(level * TIMING_WHEEL_SLOTS + int32_t((now_ >> (level * TIMING_WHEEL_SLOT_BITS)) & (TIMING_WHEEL_SLOTS - 1)));
+        }
+      }
+
+      int32_t* head = &slots_[now_ & (TIMING_WHEEL_SLOTS - 1)];
+      while (*head != NONE) {
+        const int32_t timer_id = *head;
+        unlink(timer_id);
+        on_expired(timer_id);
+      }
+    }
+  }
+
+private:
+  static constexpr int32_t NONE = -1;
+
+  struct Node {
+    int32_t next;
+    int32_t prev;
+    int32_t slot;
+    uint64_t expires;
+  };
+
+  void link(int32_t timer_id);
+  void unlink(int32_t timer_id);
+  void cascade(int32_t slot);
+
+  Node* nodes_ = nullptr;
+  int32_t max_timers_ = 0;
+  int32_t pending_count_ = 0;
+  int32_t slots_[TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS] = {};
+  uint64_t now_ = 0;
+};
+
+} //namespace
+} //namespace
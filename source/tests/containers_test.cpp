@@ -0,0 +1,253 @@
+// containers_test.cpp
+#include <thread>
+
+#include "system/containers.h"
+
+// Exercises the arena containers directly. Returns the number of failed checks.
+// Build with the ASTEROIDS_BUILD_TESTS CMake option and run through ctest.
+
+using namespace Asteroids;
+
+static int32_t failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      System::log_error("%s:%d: CHECK(%s) failed", __FILE__, __LINE__, #condition); \
+      failures++; \
+    } \
+  } while (0)
+
+// Fills an array to capacity and drains it again through pop() and swap_remove().
+static void test_array(System::MemoryArena* arena) {
+  constexpr int32_t CAPACITY = 100;
+
+  System::ArenaArray<int32_t> array;
+  CHECK(array.init(arena, CAPACITY));
+  CHECK(array.empty() && !array.full() && array.capacity() == CAPACITY);
+
+  for (int32_t i = 0; i < CAPACITY; i++) {
+    CHECK(array.push(i) != nullptr);
+  }
+
+  CHECK(array.full() && !array.empty() && array.size() == CAPACITY);
+  CHECK(array[0] == 0 && array[CAPACITY - 1] == CAPACITY - 1);
+
+#ifdef RELEASE
+  // Debug builds assert instead.
+  CHECK(array.push(CAPACITY) == nullptr);
+  CHECK(array.size() == CAPACITY);
+#endif
+
+  int64_t sum = 0;
+  for (const int32_t item : array) {
+    sum += item;
+  }
+  CHECK(sum == int64_t(CAPACITY) * (CAPACITY - 1) / 2);
+  CHECK(array.end() - array.begin() == CAPACITY);
+
+  // The last item fills the hole.
+  array.swap_remove(10);
+  CHECK(array.size() == CAPACITY - 1 && array[10] == CAPACITY - 1 && !array.full());
+
+  array.swap_remove(array.size() - 1);
+  CHECK(array.size() == CAPACITY - 2 && array[array.size() - 1] == CAPACITY - 3);
+
+  while (!array.empty()) {
+    array.pop();
+  }
+
+  CHECK(array.size() == 0 && array.begin() == array.end());
+  CHECK(array.push(7) && array.size() == 1 && array[0] == 7);
+
+  array.clear();
+  CHECK(array.empty());
+}
+
+// Bits on both sides of word boundaries, set one at a time and as ranges.
+static void test_bit_set(System::MemoryArena* arena) {
+  constexpr int32_t BIT_COUNT = 200;
+
+  System::ArenaBitSet bits;
+  CHECK(bits.init(arena, BIT_COUNT));
+  CHECK(bits.count() == 0 && bits.size() == BIT_COUNT);
+
+  const int32_t edges[] = {0, 63, 64, 127, 128, 199};
+  for (const int32_t bit : edges) {
+    bits.set(bit);
+  }
+
+  CHECK(bits.count() == 6);
+  for (int32_t i = 0; i < BIT_COUNT; i++) {
+    bool is_edge = false;
+    for (const int32_t bit : edges) {
+      is_edge = is_edge || bit == i;
+    }
+    CHECK(bits.test(i) == is_edge);
+  }
+
+  int32_t visited = 0;
+  bits.for_each([&visited, &edges](int32_t bit) {
+    CHECK(visited < 6 && bit == edges[visited]);
+    visited++;
+  });
+  CHECK(visited == 6);
+
+  bits.reset(63);
+  bits.reset(64);
+  CHECK(bits.count() == 4 && !bits.test(63) && !bits.test(64) && bits.test(127));
+
+  bits.clear();
+  CHECK(bits.count() == 0);
+
+  bits.set_range(60, 130);
+  CHECK(bits.count() == 70 && !bits.test(59) && bits.test(60) && bits.test(129) && !bits.test(130));
+
+  bits.set_range(5, 5);
+  bits.set_range(0, 1);
+  bits.set_range(199, 200);
+  CHECK(bits.count() == 72 && bits.test(0) && bits.test(199));
+
+  int32_t previous = -1;
+  bits.for_each([&previous](int32_t bit) {
+    CHECK(bit > previous);
+    previous = bit;
+  });
+  CHECK(previous == 199);
+}
+
+// Churns a small map until its tombstones force in place rehashes, then removes and reinserts what is left.
+static void test_hash_map_rehash(System::MemoryArena* arena) {
+  constexpr int32_t MAX_COUNT = 12;
+  constexpr int32_t LIVE_COUNT = 4;
+  constexpr int32_t KEY_COUNT = 1000;
+
+  System::ArenaHashMap<int32_t, int32_t> map;
+  CHECK(map.init(arena, MAX_COUNT));
+
+  for (int32_t key = 0; key < KEY_COUNT; key++) {
+    CHECK(map.put(key, key));
+    if (key >= LIVE_COUNT) {
+      CHECK(map.remove(key - LIVE_COUNT));
+    }
+  }
+
+  CHECK(map.size() == LIVE_COUNT);
+  CHECK(!map.remove(0) && map.find(0) == nullptr);
+
+  for (int32_t key = KEY_COUNT - LIVE_COUNT; key < KEY_COUNT; key++) {
+    CHECK(map.remove(key));
+    CHECK(map.find(key) == nullptr);
+    CHECK(!map.remove(key));
+  }
+
+  CHECK(map.size() == 0);
+
+  for (int32_t key = KEY_COUNT - LIVE_COUNT; key < KEY_COUNT; key++) {
+    CHECK(map.put(key, -key));
+  }
+
+  // put() on a live key hands back its slot instead of adding another.
+  int32_t* value = map.put(KEY_COUNT - 1);
+  CHECK(value && *value == 1 - KEY_COUNT);
+  CHECK(map.size() == LIVE_COUNT);
+
+  for (int32_t key = KEY_COUNT - LIVE_COUNT; key < KEY_COUNT; key++) {
+    value = map.find(key);
+    CHECK(value && *value == -key);
+  }
+}
+
+// Inserts and removes many times the capacity in keys while only a few stay live, so tombstones fill the
+// table again and again.
+static void test_hash_map_churn(System::MemoryArena* arena) {
+  constexpr int32_t MAX_COUNT = 64;
+  constexpr int32_t LIVE_COUNT = 16;
+  constexpr int32_t KEY_COUNT = 100000;
+
+  System::ArenaHashMap<int32_t, int32_t> map;
+  CHECK(map.init(arena, MAX_COUNT));
+
+  for (int32_t key = 0; key < KEY_COUNT; key++) {
+    CHECK(map.put(key, key * 3));
+
+    if (key >= LIVE_COUNT) {
+      CHECK(map.remove(key - LIVE_COUNT));
+    }
+
+    CHECK(map.size() == System::min(key + 1, LIVE_COUNT));
+  }
+
+  for (int32_t key = 0; key < KEY_COUNT - LIVE_COUNT; key += 997) {
+    CHECK(map.find(key) == nullptr);
+  }
+
+  for (int32_t key = KEY_COUNT - LIVE_COUNT; key < KEY_COUNT; key++) {
+    const int32_t* value = map.find(key);
+    CHECK(value && *value == key * 3);
+  }
+
+  // Filling up to max_count still works after all that churn.
+  for (int32_t key = 0; key < MAX_COUNT - LIVE_COUNT; key++) {
+    CHECK(map.put(-1 - key, key));
+  }
+
+  CHECK(map.size() == MAX_COUNT);
+  for (int32_t key = 0; key < MAX_COUNT - LIVE_COUNT; key++) {
+    const int32_t* value = map.find(-1 - key);
+    CHECK(value && *value == key);
+  }
+}
+
+// One thread pushes a sequence while another pops it, the order and every value must arrive intact.
+static void test_ring_buffer_threads(System::MemoryArena* arena) {
+  constexpr uint32_t ITEM_COUNT = 1000000;
+
+  System::RingBuffer<uint32_t> ring;
+  CHECK(ring.init(arena, 256));
+
+  std::thread producer([&ring]() {
+    for (uint32_t i = 0; i < ITEM_COUNT; i++) {
+      while (!ring.push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  int32_t out_of_order = 0;
+  while (expected < ITEM_COUNT) {
+    uint32_t item = 0;
+    if (ring.pop(&item)) {
+      out_of_order += item != expected ? 1 : 0;
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  CHECK(out_of_order == 0);
+  CHECK(ring.empty());
+}
+
+int main(int argc, char* argv[]) {
+  System::MemoryArena* arena = System::memory_arena_create("TEST", System::MB(64));
+  if (!arena) {
+    return 1;
+  }
+
+  test_array(arena);
+  test_bit_set(arena);
+  test_hash_map_churn(arena);
+  test_hash_map_rehash(arena);
+  test_ring_buffer_threads(arena);
+
+  System::memory_arena_free(arena);
+
+  if (failures > 0) {
+    System::log_error("%d checks failed", failures);
+  }
+
+  return failures > 0 ? 1 : 0;
+}